@@ -1,12 +1,24 @@
 #include "cbuf.h"
+#include "cbuf_copy.h"
+#include "cbuf_crc32c.h"
+#include "cbuf_file.h"
+#include "cbuf_group.h"
+#include "cbuf_tee.h"
 #include "cbuf_timeout.h"
+#include "cbuf_wait.h"
 
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 
+_Static_assert(sizeof(cbuf_t) <= CBUF_HDR_MAX_SIZE,
+               "cbuf_t outgrew CBUF_HDR_MAX_SIZE");
+_Static_assert(_Alignof(cbuf_t) == CACHELINE_SIZE,
+               "cbuf_t must be cache line aligned");
+
 /**
- * @param[in] cbuf The cbuf to initialize.
+ * @param[in] cbuf The cbuf to initialize; must be aligned to
+ * `CACHELINE_SIZE`, see `cbuf_t`.
  * @param[in] capacity The capacity in bytes.
  * @return 0 on success, -1 on failure.
  *
@@ -26,6 +38,16 @@ int cbuf_init(cbuf_t *cbuf, size_t capacity) {
   cbuf->capacity = capacity;
   atomic_init(&cbuf->readp, cbuf->buf);
   atomic_init(&cbuf->writep, cbuf->buf);
+  cbuf->flags = 0;
+  cbuf->group = NULL;
+  cbuf->group_mask = 0;
+  cbuf->file = NULL;
+  memset(&cbuf->batch, 0, sizeof(cbuf->batch));
+  memset(&cbuf->wm, 0, sizeof(cbuf->wm));
+  cbuf->tee = NULL;
+  cbuf->park_nsec = 0;
+  memset(&cbuf->read_wait, 0, sizeof(cbuf->read_wait));
+  memset(&cbuf->write_wait, 0, sizeof(cbuf->write_wait));
 
   return 0;
 }
@@ -33,7 +55,9 @@ int cbuf_init(cbuf_t *cbuf, size_t capacity) {
 /**
  * @param[in] cbuf The cbuf to free
  *
- * @brief Free the memory allocated for @p cbuf.
+ * @brief Free the memory allocated for @p cbuf. A file-backed cbuf is synced
+ * and unmapped instead, see `cbuf_close_file()`. The storage of a pooled cbuf
+ * is left alone; return it with `cbuf_pool_put()`.
  *
  * @note Not thread safe!
  */
@@ -41,14 +65,22 @@ void cbuf_free(cbuf_t *cbuf) {
   if (!cbuf)
     return;
 
+  if (cbuf->flags & CBUF_F_FILE) {
+    (void)cbuf_close_file(cbuf);
+    return;
+  }
+
   cbuf->capacity = 0;
   atomic_store(&cbuf->readp, NULL);
   atomic_store(&cbuf->writep, NULL);
-  free(cbuf->buf);
+  /* Pooled rings go back with `cbuf_pool_put()` */
+  if (!(cbuf->flags & CBUF_F_POOL))
+    free(cbuf->buf);
 }
 
 /**
- * @param[in] cbuf An uninitialized cbuf instance.
+ * @param[in] cbuf An uninitialized cbuf instance; must be aligned to
+ * `CACHELINE_SIZE`, see `cbuf_t`.
  * @param[in] buf The buffer to use.
  * @param[in] len The length of the buffer.
  * @return 0 on success, -1 for invalid arguments.
@@ -73,6 +105,16 @@ int cbuf_make(cbuf_t *cbuf, uint8_t *buf, size_t len) {
   cbuf->capacity = len;
   atomic_init(&cbuf->readp, cbuf->buf);
   atomic_init(&cbuf->writep, cbuf->buf);
+  cbuf->flags = 0;
+  cbuf->group = NULL;
+  cbuf->group_mask = 0;
+  cbuf->file = NULL;
+  memset(&cbuf->batch, 0, sizeof(cbuf->batch));
+  memset(&cbuf->wm, 0, sizeof(cbuf->wm));
+  cbuf->tee = NULL;
+  cbuf->park_nsec = 0;
+  memset(&cbuf->read_wait, 0, sizeof(cbuf->read_wait));
+  memset(&cbuf->write_wait, 0, sizeof(cbuf->write_wait));
 
   return 0;
 }
@@ -213,6 +255,198 @@ INLINE size_t readable_size(size_t capacity, uint8_t *readp, uint8_t *writep) {
     return capacity - (size_t)(readp - writep);
 }
 
+/* `cbuf_t.flags` that hook into the writer's publish path */
+#define CBUF_F_WRITE_HOOKS (CBUF_F_GROUP | CBUF_F_WATERMARK)
+/* `cbuf_t.flags` that hook into the reader's publish path */
+#define CBUF_F_READ_HOOKS (CBUF_F_WATERMARK)
+
+/* `cbuf_watermark_t.state`; the BUSY states are held while calling back */
+enum {
+  WM_LOW = 0,
+  WM_TO_HIGH,
+  WM_HIGH,
+  WM_TO_LOW,
+};
+
+/**
+ * Fire the watermark callback if the readable size crossed a watermark.
+ * Called by both sides after publishing their pointer.
+ *
+ * Each edge is claimed with a CAS into a BUSY state, so the callbacks never
+ * overlap and always alternate. A side that finds the other one BUSY leaves
+ * it alone: the owner re-checks the readable size after storing the new
+ * state, and the seq_cst fences (publish, fence, load state on one side;
+ * store state, fence, load pointers on the other) make sure that at least
+ * one of them sees the latest update, so no edge is lost.
+ */
+static void watermark_update(cbuf_t *cbuf) {
+  cbuf_watermark_t *wm = &cbuf->wm;
+  uint8_t *readp, *writep;
+  size_t nread;
+  int state, next;
+
+  for (;;) {
+    atomic_thread_fence(memory_order_seq_cst);
+    state = atomic_load_explicit(&wm->state, memory_order_relaxed);
+    readp = atomic_load_explicit(&cbuf->readp, memory_order_acquire);
+    writep = atomic_load_explicit(&cbuf->writep, memory_order_acquire);
+    nread = readable_size(cbuf->capacity, readp, writep);
+
+    if ((state == WM_LOW) && (nread >= wm->high))
+      next = WM_HIGH;
+    else if ((state == WM_HIGH) && (nread <= wm->low))
+      next = WM_LOW;
+    else
+      return;
+
+    if (!atomic_compare_exchange_strong_explicit(
+            &wm->state, &state, next == WM_HIGH ? WM_TO_HIGH : WM_TO_LOW,
+            memory_order_acq_rel, memory_order_relaxed))
+      return; /* the other side got there first */
+
+    wm->fn(cbuf, next == WM_HIGH, wm->arg);
+    atomic_store_explicit(&wm->state, next, memory_order_release);
+  }
+}
+
+/**
+ * Publish a new write pointer. All writers go through here so that the
+ * optional features hooked into the publish path (see `cbuf_t.flags`) see
+ * every update; @p old is the previously published write pointer.
+ */
+INLINE void publish_writep(cbuf_t *cbuf, uint8_t *old, uint8_t *writep) {
+  atomic_store_explicit(&cbuf->writep, writep, memory_order_release);
+
+  if (unlikely(cbuf->flags & CBUF_F_WRITE_HOOKS) && (writep != old)) {
+    if (cbuf->flags & CBUF_F_GROUP)
+      cbuf_group_notify(cbuf, old);
+    if (cbuf->flags & CBUF_F_WATERMARK)
+      watermark_update(cbuf);
+  }
+}
+
+/**
+ * Publish a new read pointer. The reader's counterpart of `publish_writep()`;
+ * @p old is the previously published read pointer.
+ */
+INLINE void publish_readp(cbuf_t *cbuf, uint8_t *old, uint8_t *readp) {
+  /* The consumed bytes may be overwritten as soon as readp is published */
+  if (unlikely(cbuf->flags & CBUF_F_TEE) && (readp != old))
+    cbuf_tee_capture(cbuf, old, readp);
+
+  atomic_store_explicit(&cbuf->readp, readp, memory_order_release);
+
+  if (unlikely(cbuf->flags & CBUF_F_READ_HOOKS)) {
+    if (cbuf->flags & CBUF_F_WATERMARK)
+      watermark_update(cbuf);
+  }
+}
+
+/**
+ * The writer's current position. With deferred publishing this may be ahead
+ * of the published `writep`.
+ */
+INLINE uint8_t *writer_pos(cbuf_t *cbuf) {
+  if (unlikely(cbuf->batch.enabled))
+    return cbuf->batch.writep;
+
+  /* Since only the writer updates writep, a relaxed load is OK */
+  return atomic_load_explicit(&cbuf->writep, memory_order_relaxed);
+}
+
+/* Publish everything written so far; returns the number of bytes published */
+static size_t flush_batch(cbuf_t *cbuf) {
+  cbuf_batch_t *batch = &cbuf->batch;
+  size_t n = batch->pending;
+
+  if (n) {
+    publish_writep(cbuf,
+                   atomic_load_explicit(&cbuf->writep, memory_order_relaxed),
+                   batch->writep);
+    batch->pending = 0;
+  }
+
+  return n;
+}
+
+static void batch_write(cbuf_t *cbuf, uint8_t *writep, size_t n) {
+  cbuf_batch_t *batch = &cbuf->batch;
+  int64_t now;
+
+  batch->writep = writep;
+
+  if (batch->max_usec) {
+    now = cbuf_time_now_usec();
+    if (!batch->pending)
+      batch->begin_usec = now;
+    batch->pending += n;
+    if (now - batch->begin_usec >= batch->max_usec) {
+      (void)flush_batch(cbuf);
+      return;
+    }
+  } else {
+    batch->pending += n;
+  }
+
+  if (batch->max_bytes && (batch->pending >= batch->max_bytes))
+    (void)flush_batch(cbuf);
+}
+
+/**
+ * Move the writer's position forward by @p n bytes from @p old to @p writep,
+ * and publish it unless deferred publishing holds it back.
+ */
+INLINE void advance_writep(cbuf_t *cbuf, uint8_t *old, uint8_t *writep,
+                           size_t n) {
+  if (likely(!cbuf->batch.enabled))
+    publish_writep(cbuf, old, writep);
+  else
+    batch_write(cbuf, writep, n);
+}
+
+/**
+ * Adaptive retry. The first retry of a call picks a mode from the expected
+ * wait: spin if it is shorter than parking would cost, yield if it is within
+ * `CBUF_WAIT_SLEEP_FACTOR` park costs, sleep otherwise. A wait that outlasts
+ * its mode's budget moves on to the next mode, so a mispredicted wait never
+ * spins for long.
+ */
+void cbuf_waiter_adapt(cbuf_waiter_t *w) {
+  int64_t now = cbuf_time_now_nsec(), ewma = w->stats->ewma_nsec;
+
+  if (!w->begin) {
+    w->begin = now;
+    if (ewma < w->park_nsec)
+      w->mode = CBUF_WAIT_SPIN;
+    else if (ewma < CBUF_WAIT_SLEEP_FACTOR * w->park_nsec)
+      w->mode = CBUF_WAIT_YIELD;
+    else
+      w->mode = CBUF_WAIT_SLEEP;
+    w->stats->waits[w->mode]++;
+    w->stats->last = w->mode;
+  }
+
+  switch (w->mode) {
+  case CBUF_WAIT_SPIN:
+    if (now - w->begin < w->park_nsec) {
+      for (int i = 0; i < 32; i++)
+        spin_pause();
+      return;
+    }
+    w->mode = CBUF_WAIT_YIELD;
+    /* fallthrough */
+  case CBUF_WAIT_YIELD:
+    if (now - w->begin < CBUF_WAIT_SLEEP_FACTOR * w->park_nsec) {
+      spin_yield();
+      return;
+    }
+    w->mode = CBUF_WAIT_SLEEP;
+    /* fallthrough */
+  default:
+    cbuf_sleep_nsec(w->park_nsec);
+  }
+}
+
 /**
  * @param[in] cbuf An initialized cbuf instance. See `cbuf_init()` and
  * `cbuf_make()`.
@@ -233,40 +467,42 @@ INLINE size_t readable_size(size_t capacity, uint8_t *readp, uint8_t *writep) {
 int cbuf_waitfor_readable(cbuf_t *cbuf, size_t nbytes, int64_t timeout_msec) {
   uint8_t *writep, *readp;
   cbuf_timeout_t timeout;
-  /* 32x pauses, 64x pauses x 32 */
-  int pause = 32, pause32 = 64;
+  cbuf_waiter_t waiter;
 
   if (!cbuf || !nbytes)
     return -1;
 
+  cbuf_waiter_begin(&waiter, cbuf, CBUF_READER);
   cbuf_timeout_begin(&timeout, timeout_msec);
   for (;;) {
     readp = atomic_load_explicit(&cbuf->readp, memory_order_relaxed);
     writep = atomic_load_explicit(&cbuf->writep, memory_order_acquire);
 
-    if (readable_size(cbuf->capacity, readp, writep) >= nbytes)
+    if (readable_size(cbuf->capacity, readp, writep) >= nbytes) {
+      cbuf_waiter_end(&waiter);
       return 1;
+    }
 
-    if (cbuf_timeout_expired(&timeout))
+    if (cbuf_timeout_expired(&timeout)) {
+      cbuf_waiter_end(&waiter);
       return 0;
+    }
 
-    decaying_sleep(pause, pause32);
+    cbuf_waiter_wait(&waiter);
   }
 }
 
 /**
  * @param[in] cbuf An initialized cbuf instance. See `cbuf_init()` and
  * `cbuf_make()`.
- * @param[in] buf The buffer to write.
- * @param[in] nbytes The maximum number of bytes to write.
+ * @param[in] nbytes The number of bytes that must become writable.
  * @param[in] timeout_msec The wait timeout (in milliseconds).
- * @return The number of bytes written, or -1 for invalid arguments.
+ * @return >0 if @p nbytes are writable, 0 if the timeout expired,
+ * -1 for invalid arguments or if @p nbytes can never fit in @p cbuf.
  *
- * @brief Lock-free blocking write for this SPSC @p cbuf.
- * This function will block using busy-waiting until some space becomes
- * available or @p timeout_msec ms have elapsed. Once any amount of free space
- * is available to write, the function writes as much as possible and returns
- * the number of bytes written.
+ * @brief Wait for at most @p timeout_msec ms for @p nbytes of free space in
+ * @p cbuf. Lets a writer apply backpressure upstream before it has the data
+ * to write. Must only be called by the writer.
  *
  * The following values of @p timeout_msec are special:
  *
@@ -274,13 +510,50 @@ int cbuf_waitfor_readable(cbuf_t *cbuf, size_t nbytes, int64_t timeout_msec) {
  *
  * - `-1`: wait indefinitely
  */
-ssize_t cbuf_write_blocking(cbuf_t *cbuf, const uint8_t *buf, size_t nbytes,
-                            int64_t timeout_msec) {
+int cbuf_waitfor_writable(cbuf_t *cbuf, size_t nbytes, int64_t timeout_msec) {
   uint8_t *writep, *readp;
+  cbuf_timeout_t timeout;
+  cbuf_waiter_t waiter;
+
+  if (!cbuf || !nbytes || (nbytes > cbuf->capacity - 1))
+    return -1;
+
+  cbuf_waiter_begin(&waiter, cbuf, CBUF_WRITER);
+  cbuf_timeout_begin(&timeout, timeout_msec);
+  for (;;) {
+    readp = atomic_load_explicit(&cbuf->readp, memory_order_acquire);
+    writep = writer_pos(cbuf);
+
+    if (cbuf->capacity - 1 - readable_size(cbuf->capacity, readp, writep) >=
+        nbytes) {
+      cbuf_waiter_end(&waiter);
+      return 1;
+    }
+
+    /* The reader can only free up space it can see */
+    if (unlikely(cbuf->batch.enabled))
+      (void)flush_batch(cbuf);
+
+    if (cbuf_timeout_expired(&timeout)) {
+      cbuf_waiter_end(&waiter);
+      return 0;
+    }
+
+    cbuf_waiter_wait(&waiter);
+  }
+}
+
+/**
+ * Common implementation of the blocking writes. If @p crc is not NULL, the
+ * data is checksummed in the same pass as the copy into the ring. Callers pass
+ * a constant @p crc, so the check is compiled out of the plain write.
+ */
+INLINE ssize_t write_blocking(cbuf_t *cbuf, const uint8_t *buf, size_t nbytes,
+                              int64_t timeout_msec, uint32_t *crc) {
+  uint8_t *writep, *readp, *old;
   ssize_t capacity, nwrite, len, rem;
   cbuf_timeout_t timeout;
-  /* 32x pauses, 64x pauses x 32 */
-  int pause = 32, pause32 = 64;
+  cbuf_waiter_t waiter;
 
   if (!cbuf || !buf || (nbytes > cbuf->capacity))
     return -1;
@@ -288,11 +561,11 @@ ssize_t cbuf_write_blocking(cbuf_t *cbuf, const uint8_t *buf, size_t nbytes,
   capacity = cbuf->capacity;
 
   /* Start the timeout and spin until there is space to write */
+  cbuf_waiter_begin(&waiter, cbuf, CBUF_WRITER);
   cbuf_timeout_begin(&timeout, timeout_msec);
   for (;;) {
     readp = atomic_load_explicit(&cbuf->readp, memory_order_acquire);
-    /* Since only the writer updates writep, a relaxed load is OK */
-    writep = atomic_load_explicit(&cbuf->writep, memory_order_relaxed);
+    writep = writer_pos(cbuf);
 
     /**
      * Scenario 1:
@@ -312,23 +585,37 @@ ssize_t cbuf_write_blocking(cbuf_t *cbuf, const uint8_t *buf, size_t nbytes,
     if (nwrite >= nbytes)
       break; /* we have enough space to write */
 
-    if (cbuf_timeout_expired(&timeout))
+    /* The reader can only free up space it can see */
+    if (unlikely(cbuf->batch.enabled))
+      (void)flush_batch(cbuf);
+
+    if (cbuf_timeout_expired(&timeout)) {
+      cbuf_waiter_end(&waiter);
       return 0; /* timed out with no free space */
+    }
 
-    decaying_sleep(pause, pause32);
+    cbuf_waiter_wait(&waiter);
   }
+  cbuf_waiter_end(&waiter);
 
   nwrite = MIN(nbytes, nwrite);
+  old = writep;
 
   /* Two-phase copy; write up to the end of the buffer */
   len = (ssize_t)(cbuf->buf + capacity - writep);
   len = MIN(len, nwrite);
-  memcpy(writep, buf, len);
+  if (crc)
+    *crc = cbuf_crc32c_copy(*crc, writep, buf, len);
+  else
+    cbuf_copy_in(writep, buf, len);
 
   rem = nwrite - len;
   /* If necessary, wrap around and write from the beginning */
   if (rem) {
-    memcpy(cbuf->buf, buf + len, rem);
+    if (crc)
+      *crc = cbuf_crc32c_copy(*crc, cbuf->buf, buf + len, rem);
+    else
+      cbuf_copy_in(cbuf->buf, buf + len, rem);
     writep = cbuf->buf + rem;
   } else {
     writep += len;
@@ -336,31 +623,23 @@ ssize_t cbuf_write_blocking(cbuf_t *cbuf, const uint8_t *buf, size_t nbytes,
       writep = cbuf->buf;
   }
 
-  atomic_store_explicit(&cbuf->writep, writep, memory_order_release);
+  advance_writep(cbuf, old, writep, nwrite);
   return nwrite;
 }
 
 /**
  * @param[in] cbuf An initialized cbuf instance. See `cbuf_init()` and
  * `cbuf_make()`.
- * @param[out] buf The buffer to read into.
- * @param[in] nbytes The maximum number of bytes to read.
+ * @param[in] buf The buffer to write.
+ * @param[in] nbytes The maximum number of bytes to write.
  * @param[in] timeout_msec The wait timeout (in milliseconds).
- * @param[in] all Enforce all-or-nothing behaviour.
- * @return The number of bytes read into @p buf, or -1 for invalid arguments.
- *
- * @brief Lock-free blocking read for this SPSC @p cbuf. This function will
- * block for at most @p timeout_msec ms using busy-waiting until @p nbytes are
- * readable. Data is read with FIFO ordering.
- *
- * - If @p all is set to `true`, the function will read exactly @p nbytes bytes
- * from @p cbuf. If there are not enough bytes to read, the function returns 0;
- * Otherwise, it returns @p nbytes.
+ * @return The number of bytes written, or -1 for invalid arguments.
  *
- * - If @p all is set to `false`, the function will wait no longer than
- * @p timeout_msec ms until @p nbytes are available to read. If the timeout
- * expires before the data becomes available, the function reads whatever bytes
- * are available and returns the number of bytes read.
+ * @brief Lock-free blocking write for this SPSC @p cbuf.
+ * This function will block using busy-waiting until some space becomes
+ * available or @p timeout_msec ms have elapsed. Once any amount of free space
+ * is available to write, the function writes as much as possible and returns
+ * the number of bytes written.
  *
  * The following values of @p timeout_msec are special:
  *
@@ -368,13 +647,42 @@ ssize_t cbuf_write_blocking(cbuf_t *cbuf, const uint8_t *buf, size_t nbytes,
  *
  * - `-1`: wait indefinitely
  */
-ssize_t cbuf_read_blocking(cbuf_t *cbuf, uint8_t *buf, size_t nbytes,
-                           int64_t timeout_msec, bool all) {
-  uint8_t *writep, *readp;
+ssize_t cbuf_write_blocking(cbuf_t *cbuf, const uint8_t *buf, size_t nbytes,
+                            int64_t timeout_msec) {
+  return write_blocking(cbuf, buf, nbytes, timeout_msec, NULL);
+}
+
+/**
+ * @param[in] cbuf An initialized cbuf instance. See `cbuf_init()` and
+ * `cbuf_make()`.
+ * @param[in] buf The buffer to write.
+ * @param[in] nbytes The maximum number of bytes to write.
+ * @param[in] timeout_msec The wait timeout (in milliseconds).
+ * @param[in,out] crc The CRC32C so far (0 to start a new one), updated with
+ * the bytes written.
+ * @return The number of bytes written, or -1 for invalid arguments.
+ *
+ * @brief Same as `cbuf_write_blocking()`, but also computes the CRC32C of the
+ * written data in the same pass as the copy into @p cbuf. @p crc is left
+ * unchanged if nothing was written. See `cbuf_crc32c()`.
+ */
+ssize_t cbuf_write_crc32c(cbuf_t *cbuf, const uint8_t *buf, size_t nbytes,
+                          int64_t timeout_msec, uint32_t *crc) {
+  if (!crc)
+    return -1;
+
+  return write_blocking(cbuf, buf, nbytes, timeout_msec, crc);
+}
+
+/**
+ * Common implementation of the blocking reads; see `write_blocking()`.
+ */
+INLINE ssize_t read_blocking(cbuf_t *cbuf, uint8_t *buf, size_t nbytes,
+                             int64_t timeout_msec, bool all, uint32_t *crc) {
+  uint8_t *writep, *readp, *old;
   ssize_t capacity, nread, len, rem;
   cbuf_timeout_t timeout;
-  /* 32x pauses, 64x pauses x 32 */
-  int pause = 32, pause32 = 64;
+  cbuf_waiter_t waiter;
 
   if (!cbuf || !buf || (nbytes > cbuf->capacity))
     return -1;
@@ -382,6 +690,7 @@ ssize_t cbuf_read_blocking(cbuf_t *cbuf, uint8_t *buf, size_t nbytes,
   capacity = cbuf->capacity;
 
   /* spinlock */
+  cbuf_waiter_begin(&waiter, cbuf, CBUF_READER);
   cbuf_timeout_begin(&timeout, timeout_msec);
   for (;;) {
     readp = atomic_load_explicit(&cbuf->readp, memory_order_relaxed);
@@ -395,8 +704,9 @@ ssize_t cbuf_read_blocking(cbuf_t *cbuf, uint8_t *buf, size_t nbytes,
     if (cbuf_timeout_expired(&timeout))
       break;
 
-    decaying_sleep(pause, pause32);
+    cbuf_waiter_wait(&waiter);
   }
+  cbuf_waiter_end(&waiter);
 
   if (nread <= 0)
     return 0;
@@ -404,16 +714,23 @@ ssize_t cbuf_read_blocking(cbuf_t *cbuf, uint8_t *buf, size_t nbytes,
     return 0;
 
   nread = MIN(nbytes, nread);
+  old = readp;
 
   /* Read up to the end of the buffer */
   len = (ssize_t)(cbuf->buf + capacity - readp);
   len = MIN(len, nread);
-  memcpy(buf, readp, len);
+  if (crc)
+    *crc = cbuf_crc32c_copy(*crc, buf, readp, len);
+  else
+    memcpy(buf, readp, len);
 
   rem = nread - len;
   /* If necessary, wrap around and read from the beginning of the buffer */
   if (rem) {
-    memcpy(buf + len, cbuf->buf, rem);
+    if (crc)
+      *crc = cbuf_crc32c_copy(*crc, buf + len, cbuf->buf, rem);
+    else
+      memcpy(buf + len, cbuf->buf, rem);
     readp = cbuf->buf + rem;
   } else {
     readp += len;
@@ -421,10 +738,72 @@ ssize_t cbuf_read_blocking(cbuf_t *cbuf, uint8_t *buf, size_t nbytes,
       readp = cbuf->buf;
   }
 
-  atomic_store_explicit(&cbuf->readp, readp, memory_order_release);
+  publish_readp(cbuf, old, readp);
+
+  /* Warm up the start of the next readable span, if there is one */
+  if (readp != writep)
+    cbuf_copy_prefetch(readp, readp < writep
+                                  ? (size_t)(writep - readp)
+                                  : (size_t)(cbuf->buf + capacity - readp));
   return nread;
 }
 
+/**
+ * @param[in] cbuf An initialized cbuf instance. See `cbuf_init()` and
+ * `cbuf_make()`.
+ * @param[out] buf The buffer to read into.
+ * @param[in] nbytes The maximum number of bytes to read.
+ * @param[in] timeout_msec The wait timeout (in milliseconds).
+ * @param[in] all Enforce all-or-nothing behaviour.
+ * @return The number of bytes read into @p buf, or -1 for invalid arguments.
+ *
+ * @brief Lock-free blocking read for this SPSC @p cbuf. This function will
+ * block for at most @p timeout_msec ms using busy-waiting until @p nbytes are
+ * readable. Data is read with FIFO ordering.
+ *
+ * - If @p all is set to `true`, the function will read exactly @p nbytes bytes
+ * from @p cbuf. If there are not enough bytes to read, the function returns 0;
+ * Otherwise, it returns @p nbytes.
+ *
+ * - If @p all is set to `false`, the function will wait no longer than
+ * @p timeout_msec ms until @p nbytes are available to read. If the timeout
+ * expires before the data becomes available, the function reads whatever bytes
+ * are available and returns the number of bytes read.
+ *
+ * The following values of @p timeout_msec are special:
+ *
+ * - `0`: return immediately
+ *
+ * - `-1`: wait indefinitely
+ */
+ssize_t cbuf_read_blocking(cbuf_t *cbuf, uint8_t *buf, size_t nbytes,
+                           int64_t timeout_msec, bool all) {
+  return read_blocking(cbuf, buf, nbytes, timeout_msec, all, NULL);
+}
+
+/**
+ * @param[in] cbuf An initialized cbuf instance. See `cbuf_init()` and
+ * `cbuf_make()`.
+ * @param[out] buf The buffer to read into.
+ * @param[in] nbytes The maximum number of bytes to read.
+ * @param[in] timeout_msec The wait timeout (in milliseconds).
+ * @param[in] all Enforce all-or-nothing behaviour.
+ * @param[in,out] crc The CRC32C so far (0 to start a new one), updated with
+ * the bytes read.
+ * @return The number of bytes read into @p buf, or -1 for invalid arguments.
+ *
+ * @brief Same as `cbuf_read_blocking()`, but also computes the CRC32C of the
+ * read data in the same pass as the copy out of @p cbuf. @p crc is left
+ * unchanged if nothing was read. See `cbuf_crc32c()`.
+ */
+ssize_t cbuf_read_crc32c(cbuf_t *cbuf, uint8_t *buf, size_t nbytes,
+                         int64_t timeout_msec, bool all, uint32_t *crc) {
+  if (!crc)
+    return -1;
+
+  return read_blocking(cbuf, buf, nbytes, timeout_msec, all, crc);
+}
+
 /**
  * @param[in] cbuf An initialized cbuf instance. See `cbuf_init()` and
  * `cbuf_make()`.
@@ -459,6 +838,39 @@ ssize_t cbuf_peek(cbuf_t *cbuf, uint8_t *buf, size_t nbytes) {
   return nread;
 }
 
+/**
+ * @param[in] cbuf An initialized cbuf instance. See `cbuf_init()` and
+ * `cbuf_make()`.
+ * @param[in] offset The offset from the start of the readable data.
+ * @param[out] buf The buffer to read into.
+ * @param[in] nbytes The size of the @p buf.
+ * @return The number of bytes read, which is 0 if no more than @p offset bytes
+ * are readable, or -1 for invalid arguments.
+ *
+ * @brief Same as `cbuf_peek()`, but start reading @p offset bytes into the
+ * readable data instead of at the start, so that a field deep inside the next
+ * record can be inspected without copying everything in front of it. Must
+ * only be called by the reader.
+ */
+ssize_t cbuf_peek_at(cbuf_t *cbuf, size_t offset, uint8_t *buf,
+                     size_t nbytes) {
+  cbuf_segs_t segs;
+  ssize_t nread;
+
+  if (!buf)
+    return -1;
+
+  nread = cbuf_view_at(cbuf, offset, nbytes, &segs);
+  if (nread <= 0)
+    return nread;
+
+  memcpy(buf, segs.ptr[0], segs.len[0]);
+  if (segs.len[1])
+    memcpy(buf + segs.len[0], segs.ptr[1], segs.len[1]);
+
+  return nread;
+}
+
 /**
  * @param[in] cbuf An initialized cbuf instance. See `cbuf_init()` and
  * `cbuf_make()`.
@@ -468,20 +880,604 @@ ssize_t cbuf_peek(cbuf_t *cbuf, uint8_t *buf, size_t nbytes) {
  * @brief Delete no more than @p nbytes bytes from the @p cbuf in FIFO order.
  */
 ssize_t cbuf_remove(cbuf_t *cbuf, size_t nbytes) {
-  uint8_t *readp, *writep;
+  uint8_t *readp, *writep, *old;
   ssize_t n;
   size_t capacity;
 
   if (!cbuf)
     return -1;
 
+  capacity = cbuf->capacity;
+  old = atomic_load_explicit(&cbuf->readp, memory_order_relaxed);
+  writep = atomic_load_explicit(&cbuf->writep, memory_order_acquire);
+
+  n = MIN(readable_size(capacity, old, writep), nbytes);
+  readp = cbuf->buf + ((size_t)(old - cbuf->buf) + n) % capacity;
+
+  publish_readp(cbuf, old, readp);
+  return n;
+}
+
+/**
+ * @param[in] cbuf An initialized cbuf instance. See `cbuf_init()` and
+ * `cbuf_make()`.
+ * @param[out] segs The readable region of @p cbuf.
+ * @return The number of readable bytes, or -1 for invalid arguments.
+ *
+ * @brief Get a zero-copy view of the data readable from @p cbuf. The data is
+ * split into at most two segments at the end of the internal buffer; the
+ * second segment is empty if the data does not wrap around.
+ *
+ * The segments stay valid until the reader consumes the data with
+ * `cbuf_remove()`. This function must only be called by the reader.
+ */
+ssize_t cbuf_get_read_segs(cbuf_t *cbuf, cbuf_segs_t *segs) {
+  uint8_t *readp, *writep;
+  size_t capacity, nread, len;
+
+  if (!cbuf || !segs)
+    return -1;
+
   capacity = cbuf->capacity;
   readp = atomic_load_explicit(&cbuf->readp, memory_order_relaxed);
   writep = atomic_load_explicit(&cbuf->writep, memory_order_acquire);
 
-  n = MIN(readable_size(capacity, readp, writep), nbytes);
-  readp = cbuf->buf + ((size_t)(readp - cbuf->buf) + n) % capacity;
+  nread = readable_size(capacity, readp, writep);
+  len = (size_t)(cbuf->buf + capacity - readp);
+  len = MIN(len, nread);
 
-  atomic_store_explicit(&cbuf->readp, readp, memory_order_release);
+  segs->ptr[0] = readp;
+  segs->len[0] = len;
+  segs->ptr[1] = cbuf->buf;
+  segs->len[1] = nread - len;
+
+  return nread;
+}
+
+/**
+ * @param[in] cbuf An initialized cbuf instance. See `cbuf_init()` and
+ * `cbuf_make()`.
+ * @param[in] offset The offset from the start of the readable data.
+ * @param[in] len The maximum length of the view.
+ * @param[out] segs The viewed region of @p cbuf.
+ * @return The number of bytes in the view, which is 0 if no more than
+ * @p offset bytes are readable, or -1 for invalid arguments.
+ *
+ * @brief Get a zero-copy view of no more than @p len readable bytes of
+ * @p cbuf, starting @p offset bytes into the readable data. Like
+ * `cbuf_get_read_segs()`, the view is split into at most two segments at the
+ * end of the internal buffer and stays valid until the reader consumes the
+ * data. This function must only be called by the reader.
+ */
+ssize_t cbuf_view_at(cbuf_t *cbuf, size_t offset, size_t len,
+                     cbuf_segs_t *segs) {
+  uint8_t *readp, *writep;
+  size_t capacity, nread, first;
+
+  if (!cbuf || !segs)
+    return -1;
+
+  capacity = cbuf->capacity;
+  readp = atomic_load_explicit(&cbuf->readp, memory_order_relaxed);
+  writep = atomic_load_explicit(&cbuf->writep, memory_order_acquire);
+
+  nread = readable_size(capacity, readp, writep);
+  offset = MIN(offset, nread);
+  len = MIN(len, nread - offset);
+
+  /* offset < capacity, so this wraps at most once */
+  readp += offset;
+  if (readp >= cbuf->buf + capacity)
+    readp -= capacity;
+
+  first = (size_t)(cbuf->buf + capacity - readp);
+  first = MIN(first, len);
+
+  segs->ptr[0] = readp;
+  segs->len[0] = first;
+  segs->ptr[1] = cbuf->buf;
+  segs->len[1] = len - first;
+
+  return len;
+}
+
+/**
+ * @param[in] cbuf An initialized cbuf instance. See `cbuf_init()` and
+ * `cbuf_make()`.
+ * @param[out] segs The writable region of @p cbuf.
+ * @return The number of writable bytes, or -1 for invalid arguments.
+ *
+ * @brief Get a zero-copy view of the free space in @p cbuf. The space is split
+ * into at most two segments at the end of the internal buffer; the second
+ * segment is empty if the free space does not wrap around.
+ *
+ * Data written into the segments becomes visible to the reader only after it
+ * is published with `cbuf_commit()`. This function must only be called by the
+ * writer.
+ */
+ssize_t cbuf_get_write_segs(cbuf_t *cbuf, cbuf_segs_t *segs) {
+  uint8_t *readp, *writep;
+  size_t capacity, nwrite, len;
+
+  if (!cbuf || !segs)
+    return -1;
+
+  capacity = cbuf->capacity;
+  readp = atomic_load_explicit(&cbuf->readp, memory_order_acquire);
+  writep = writer_pos(cbuf);
+
+  nwrite = capacity - 1 - readable_size(capacity, readp, writep);
+  len = (size_t)(cbuf->buf + capacity - writep);
+  len = MIN(len, nwrite);
+
+  segs->ptr[0] = writep;
+  segs->len[0] = len;
+  segs->ptr[1] = cbuf->buf;
+  segs->len[1] = nwrite - len;
+
+  return nwrite;
+}
+
+/**
+ * @param[in] cbuf An initialized cbuf instance. See `cbuf_init()` and
+ * `cbuf_make()`.
+ * @param[in] nbytes The number of bytes to publish.
+ * @return The number of bytes published, or -1 for invalid arguments.
+ *
+ * @brief Publish no more than @p nbytes bytes written into the segments
+ * returned by `cbuf_get_write_segs()`, making them readable (subject to
+ * `cbuf_set_batching()`). This is the writer's counterpart of `cbuf_remove()`.
+ */
+ssize_t cbuf_commit(cbuf_t *cbuf, size_t nbytes) {
+  uint8_t *readp, *writep, *old;
+  size_t capacity, n;
+
+  if (!cbuf)
+    return -1;
+
+  capacity = cbuf->capacity;
+  readp = atomic_load_explicit(&cbuf->readp, memory_order_acquire);
+  old = writer_pos(cbuf);
+
+  n = MIN(capacity - 1 - readable_size(capacity, readp, old), nbytes);
+  if (!n)
+    return 0;
+  writep = cbuf->buf + ((size_t)(old - cbuf->buf) + n) % capacity;
+
+  advance_writep(cbuf, old, writep, n);
   return n;
 }
+
+/**
+ * Compare @p patlen bytes of @p pat with the data at offset @p offs of the
+ * readable region described by @p segs, following the wrap around.
+ */
+INLINE bool segs_match(const cbuf_segs_t *segs, size_t offs,
+                       const uint8_t *pat, size_t patlen) {
+  size_t len;
+
+  if (offs < segs->len[0]) {
+    len = MIN(segs->len[0] - offs, patlen);
+    if (memcmp(segs->ptr[0] + offs, pat, len))
+      return false;
+    return !memcmp(segs->ptr[1], pat + len, patlen - len);
+  }
+
+  return !memcmp(segs->ptr[1] + (offs - segs->len[0]), pat, patlen);
+}
+
+/**
+ * Find the first occurrence of @p pat starting at offset @p from of the
+ * readable region described by @p segs. Candidates are located with
+ * `memchr()` on the first byte of the pattern (which libc vectorizes), one
+ * segment at a time, and then verified across the wrap point if necessary.
+ *
+ * @return The offset of the match, or -1 if there is none.
+ */
+static ssize_t segs_find(const cbuf_segs_t *segs, size_t from,
+                         const uint8_t *pat, size_t patlen) {
+  size_t total = segs->len[0] + segs->len[1], base, offs;
+  const uint8_t *p, *end;
+  int i;
+
+  if ((patlen > total) || (from > total - patlen))
+    return -1;
+
+  for (i = 0, base = 0; i < 2; base += segs->len[i], i++) {
+    if (from >= base + segs->len[i])
+      continue;
+
+    p = segs->ptr[i] + (from > base ? from - base : 0);
+    end = segs->ptr[i] + segs->len[i];
+    while ((p = memchr(p, pat[0], end - p)) != NULL) {
+      offs = base + (size_t)(p - segs->ptr[i]);
+      if (offs > total - patlen)
+        return -1;
+      if ((patlen == 1) || segs_match(segs, offs, pat, patlen))
+        return offs;
+      p++;
+    }
+  }
+
+  return -1;
+}
+
+/**
+ * @param[in] cbuf An initialized cbuf instance. See `cbuf_init()` and
+ * `cbuf_make()`.
+ * @param[in] pat The byte pattern to search for.
+ * @param[in] patlen The length of @p pat; 1 to search for a single byte.
+ * @return The offset of the first occurrence of @p pat from the start of the
+ * readable data, or -1 if it was not found or for invalid arguments.
+ *
+ * @brief Search the readable data of @p cbuf for @p pat in place, without
+ * copying or consuming anything. Matches that straddle the end of the
+ * internal buffer are found as well. Must only be called by the reader.
+ */
+ssize_t cbuf_find(cbuf_t *cbuf, const uint8_t *pat, size_t patlen) {
+  cbuf_segs_t segs;
+
+  if (!pat || !patlen || (cbuf_get_read_segs(cbuf, &segs) < 0))
+    return -1;
+
+  return segs_find(&segs, 0, pat, patlen);
+}
+
+/**
+ * @param[in] cbuf An initialized cbuf instance. See `cbuf_init()` and
+ * `cbuf_make()`.
+ * @param[out] buf The buffer to read into.
+ * @param[in] nbytes The size of @p buf.
+ * @param[in] delim The delimiter to read up to.
+ * @param[in] delimlen The length of @p delim.
+ * @param[in] timeout_msec The wait timeout (in milliseconds).
+ * @return The number of bytes read into @p buf including the delimiter, 0 if
+ * the timeout expired before a delimiter was found, or -1 for invalid
+ * arguments or if the first @p nbytes readable bytes do not contain a
+ * delimiter.
+ *
+ * @brief Read from @p cbuf up to and including the first occurrence of
+ * @p delim, waiting for at most @p timeout_msec ms for it to arrive. The data
+ * is scanned in place, and data already scanned while waiting is not scanned
+ * again. Nothing is consumed unless a delimiter is found.
+ *
+ * The following values of @p timeout_msec are special:
+ *
+ * - `0`: return immediately
+ *
+ * - `-1`: wait indefinitely
+ */
+ssize_t cbuf_read_until(cbuf_t *cbuf, uint8_t *buf, size_t nbytes,
+                        const uint8_t *delim, size_t delimlen,
+                        int64_t timeout_msec) {
+  cbuf_segs_t segs;
+  cbuf_timeout_t timeout;
+  ssize_t nread, offs;
+  size_t from = 0, len;
+  cbuf_waiter_t waiter;
+
+  if (!cbuf || !buf || !delim || !delimlen || (delimlen > nbytes))
+    return -1;
+
+  cbuf_waiter_begin(&waiter, cbuf, CBUF_READER);
+  cbuf_timeout_begin(&timeout, timeout_msec);
+  for (;;) {
+    nread = cbuf_get_read_segs(cbuf, &segs);
+    /* Only look for delimiters that end within buf */
+    if ((size_t)nread > nbytes) {
+      if (segs.len[0] > nbytes) {
+        segs.len[0] = nbytes;
+        segs.len[1] = 0;
+      } else {
+        segs.len[1] = nbytes - segs.len[0];
+      }
+    }
+
+    offs = segs_find(&segs, from, delim, delimlen);
+    if (offs >= 0)
+      break;
+
+    if ((size_t)nread >= nbytes) {
+      cbuf_waiter_end(&waiter);
+      return -1; /* buf can never hold a full record */
+    }
+
+    /* A match may still start in the last delimlen-1 bytes */
+    if ((size_t)nread >= delimlen)
+      from = nread - delimlen + 1;
+
+    if (cbuf_timeout_expired(&timeout)) {
+      cbuf_waiter_end(&waiter);
+      return 0;
+    }
+
+    cbuf_waiter_wait(&waiter);
+  }
+  cbuf_waiter_end(&waiter);
+
+  nread = offs + delimlen;
+  len = MIN(segs.len[0], (size_t)nread);
+  memcpy(buf, segs.ptr[0], len);
+  if (nread - len)
+    memcpy(buf + len, segs.ptr[1], nread - len);
+
+  return cbuf_remove(cbuf, nread);
+}
+
+/**
+ * Copy @p n bytes from the segments @p src into the segments @p dst. Both
+ * may wrap at different offsets, so this takes at most three copies.
+ */
+static void segs_copy(const cbuf_segs_t *dst, const cbuf_segs_t *src,
+                      size_t n) {
+  size_t di = 0, si = 0, doff = 0, soff = 0, len;
+
+  while (n) {
+    len = MIN(dst->len[di] - doff, src->len[si] - soff);
+    len = MIN(len, n);
+    cbuf_copy_in(dst->ptr[di] + doff, src->ptr[si] + soff, len);
+    n -= len;
+
+    doff += len;
+    if (doff == dst->len[di]) {
+      di++;
+      doff = 0;
+    }
+    soff += len;
+    if (soff == src->len[si]) {
+      si++;
+      soff = 0;
+    }
+  }
+}
+
+/**
+ * @param[in] dst The cbuf to write to; the caller must be its writer.
+ * @param[in] src The cbuf to read from; the caller must be its reader.
+ * @param[in] nbytes The maximum number of bytes to move.
+ * @param[in] timeout_msec The wait timeout (in milliseconds).
+ * @return The number of bytes moved, 0 on timeout, or -1 for invalid
+ * arguments.
+ *
+ * @brief Move no more than @p nbytes bytes from @p src to @p dst, copying
+ * straight from the readable segments of @p src into the writable segments of
+ * @p dst, without an intermediate buffer. Waits for at most @p timeout_msec
+ * ms until @p src has data and @p dst has space, then moves as much as both
+ * allow in one go.
+ *
+ * The following values of @p timeout_msec are special:
+ *
+ * - `0`: return immediately
+ *
+ * - `-1`: wait indefinitely
+ */
+ssize_t cbuf_splice(cbuf_t *dst, cbuf_t *src, size_t nbytes,
+                    int64_t timeout_msec) {
+  cbuf_segs_t rsegs, wsegs;
+  cbuf_timeout_t timeout;
+  size_t n;
+  cbuf_waiter_t waiter;
+
+  if (!dst || !src || (dst == src))
+    return -1;
+
+  if (!nbytes)
+    return 0;
+
+  cbuf_waiter_begin(&waiter, src, CBUF_READER);
+  cbuf_timeout_begin(&timeout, timeout_msec);
+  for (;;) {
+    n = MIN((size_t)cbuf_get_read_segs(src, &rsegs),
+            (size_t)cbuf_get_write_segs(dst, &wsegs));
+    if (n)
+      break;
+
+    /* The reader of dst can only free up space it can see */
+    if (unlikely(dst->batch.enabled))
+      (void)flush_batch(dst);
+
+    if (cbuf_timeout_expired(&timeout)) {
+      cbuf_waiter_end(&waiter);
+      return 0;
+    }
+
+    cbuf_waiter_wait(&waiter);
+  }
+  cbuf_waiter_end(&waiter);
+
+  n = MIN(n, nbytes);
+  segs_copy(&wsegs, &rsegs, n);
+
+  /* Publish into dst before handing the space back to the writer of src */
+  (void)cbuf_commit(dst, n);
+  return cbuf_remove(src, n);
+}
+
+/**
+ * @param[in] cbuf An initialized cbuf instance. See `cbuf_init()` and
+ * `cbuf_make()`.
+ * @param[in] max_bytes Publish once this many bytes are pending, or 0 for no
+ * size limit.
+ * @param[in] max_usec Publish once the oldest pending write is this many
+ * microseconds old, or 0 for no age limit.
+ * @return 0 on success, -1 for invalid arguments.
+ *
+ * @brief Enable deferred publishing of the writes to @p cbuf.
+ *
+ * Every write normally publishes the new write pointer with a release store,
+ * which moves the cache line holding it over to the reader. With deferred
+ * publishing, writes still copy their data into the ring right away but the
+ * write pointer is only published by `cbuf_flush()`, or by the write that
+ * takes the pending bytes or age over one of the limits, whichever comes
+ * first. The reader sees fewer, larger updates.
+ *
+ * - The age limit is only checked by writes, so a writer that goes idle must
+ * call `cbuf_flush()` to publish its last writes.
+ *
+ * - A write that has to wait for free space publishes the pending bytes
+ * first, so the reader can make progress.
+ *
+ * - Pass `0` for both limits to disable deferred publishing (pending bytes
+ * are published), or `SIZE_MAX` and `0` to publish only on `cbuf_flush()`.
+ *
+ * @note Must only be called by the writer.
+ */
+int cbuf_set_batching(cbuf_t *cbuf, size_t max_bytes, int64_t max_usec) {
+  if (!cbuf || (max_usec < 0))
+    return -1;
+
+  if (!max_bytes && !max_usec) {
+    if (cbuf->batch.enabled) {
+      (void)flush_batch(cbuf);
+      cbuf->batch.enabled = false;
+    }
+    return 0;
+  }
+
+  if (!cbuf->batch.enabled) {
+    cbuf->batch.writep =
+        atomic_load_explicit(&cbuf->writep, memory_order_relaxed);
+    cbuf->batch.pending = 0;
+    cbuf->batch.enabled = true;
+  }
+  cbuf->batch.max_bytes = max_bytes;
+  cbuf->batch.max_usec = max_usec;
+
+  return 0;
+}
+
+/**
+ * @param[in] cbuf An initialized cbuf instance. See `cbuf_init()` and
+ * `cbuf_make()`.
+ * @return The number of bytes published, or -1 for invalid arguments.
+ *
+ * @brief Publish all the writes held back by deferred publishing. See
+ * `cbuf_set_batching()`.
+ *
+ * @note Must only be called by the writer.
+ */
+ssize_t cbuf_flush(cbuf_t *cbuf) {
+  if (!cbuf)
+    return -1;
+
+  if (!cbuf->batch.enabled)
+    return 0;
+
+  return flush_batch(cbuf);
+}
+
+/**
+ * @param[in] cbuf An initialized cbuf instance. See `cbuf_init()` and
+ * `cbuf_make()`.
+ * @param[in] low The low watermark in bytes.
+ * @param[in] high The high watermark in bytes.
+ * @param[in] fn The function to call when a watermark is crossed, or NULL to
+ * disable the watermarks.
+ * @param[in] arg Opaque argument passed to @p fn.
+ * @return 0 on success, -1 for invalid arguments.
+ *
+ * @brief Call @p fn when the readable size of @p cbuf rises to @p high bytes
+ * (with `high = true`), and again when it falls back to @p low bytes (with
+ * `high = false`), so that an upstream source can be paused before the ring
+ * is full and resumed once it has drained.
+ *
+ * - The calls always alternate, starting with a high one, and never overlap.
+ *
+ * - @p fn is called from whichever side's publish crossed the watermark, so
+ * usually the writer for the high edge and the reader for the low edge. It
+ * may be called from either, and must not read from or write to @p cbuf.
+ *
+ * - @p low must be below @p high, and @p high must not exceed
+ * `cbuf_get_capacity()`.
+ *
+ * @note Not thread safe! Set the watermarks before starting the reader and
+ * the writer.
+ */
+int cbuf_set_watermarks(cbuf_t *cbuf, size_t low, size_t high,
+                        cbuf_watermark_fn fn, void *arg) {
+  if (!cbuf)
+    return -1;
+
+  if (!fn) {
+    cbuf->flags &= ~CBUF_F_WATERMARK;
+    cbuf->wm.fn = NULL;
+    return 0;
+  }
+
+  if ((low >= high) || (high > cbuf->capacity - 1))
+    return -1;
+
+  cbuf->wm.low = low;
+  cbuf->wm.high = high;
+  cbuf->wm.fn = fn;
+  cbuf->wm.arg = arg;
+  atomic_init(&cbuf->wm.state, WM_LOW);
+  cbuf->flags |= CBUF_F_WATERMARK;
+
+  /* The ring may already be above the high watermark */
+  watermark_update(cbuf);
+  return 0;
+}
+
+/**
+ * @param[in] cbuf An initialized cbuf instance. See `cbuf_init()` and
+ * `cbuf_make()`.
+ * @param[in] enable Enable or disable adaptive waiting.
+ * @param[in] park_nsec The cost of parking a waiting thread (in nanoseconds),
+ * or 0 for `CBUF_WAIT_PARK_NSEC`.
+ * @return 0 on success, -1 for invalid arguments.
+ *
+ * @brief Let the blocking calls on @p cbuf pick how to wait from the waits
+ * they saw before, instead of the fixed `decaying_sleep()` schedule.
+ *
+ * Each side keeps an EWMA of how long its recent waits took. A call that has
+ * to wait spins if the expected wait is below @p park_nsec, yields the
+ * processor if it is below 20 times that, and sleeps for @p park_nsec at a
+ * time otherwise. So a ring with microsecond gaps keeps spinning where the
+ * fixed schedule would already yield, and a ring that is idle for seconds
+ * stops burning CPU right away. The decisions made are counted per side, see
+ * `cbuf_get_wait_stats()`.
+ *
+ * Calls that return without waiting do not count as waits. Enabling resets
+ * the statistics of both sides.
+ *
+ * @note Not thread safe! Configure this before starting the reader and the
+ * writer.
+ */
+int cbuf_set_adaptive_wait(cbuf_t *cbuf, bool enable, int64_t park_nsec) {
+  if (!cbuf || (park_nsec < 0))
+    return -1;
+
+  if (!enable) {
+    cbuf->flags &= ~CBUF_F_ADAPTIVE;
+    return 0;
+  }
+
+  cbuf->park_nsec = park_nsec ? park_nsec : CBUF_WAIT_PARK_NSEC;
+  memset(&cbuf->read_wait, 0, sizeof(cbuf->read_wait));
+  memset(&cbuf->write_wait, 0, sizeof(cbuf->write_wait));
+  cbuf->flags |= CBUF_F_ADAPTIVE;
+  return 0;
+}
+
+/**
+ * @param[in] cbuf An initialized cbuf instance. See `cbuf_init()` and
+ * `cbuf_make()`.
+ * @param[in] side The side to get the statistics of.
+ * @param[out] stats The expected wait and the decisions made so far.
+ * @return 0 on success, -1 for invalid arguments.
+ *
+ * @brief Get the adaptive wait statistics of one side of @p cbuf, see
+ * `cbuf_set_adaptive_wait()`.
+ *
+ * @note The statistics are only updated by their own side; call this from
+ * that side's thread, or once it has stopped, for a consistent snapshot.
+ */
+int cbuf_get_wait_stats(cbuf_t *cbuf, cbuf_side_t side,
+                        cbuf_wait_stats_t *stats) {
+  if (!cbuf || !stats || ((side != CBUF_READER) && (side != CBUF_WRITER)))
+    return -1;
+
+  *stats = (side == CBUF_READER) ? cbuf->read_wait : cbuf->write_wait;
+  return 0;
+}
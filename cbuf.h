@@ -2,12 +2,104 @@
 
 #include "defs.h"
 
+#ifdef __cplusplus
+/**
+ * Allow C++ code to include this header (see cbuf.hpp). `std::atomic<T>` is
+ * layout compatible with C11 `_Atomic(T)` on all the supported compilers.
+ * These macros are restored at the end of this header, so they never leak
+ * into the including code.
+ */
+#include <atomic>
+#pragma push_macro("_Alignas")
+#pragma push_macro("_Atomic")
+#pragma push_macro("restrict")
+#undef _Alignas
+#undef _Atomic
+#undef restrict
+#define _Alignas(N) alignas(N)
+#define _Atomic(T) std::atomic<T>
+#define restrict __restrict
+extern "C" {
+#else
 #include <stdatomic.h>
+#endif
 
 /* Min capacity of a cbuf for `cbuf_init()` and `cbuf_make()` */
 #define CBUF_MIN_CAPACITY 512U
 /* Max capacity of a cbuf for `cbuf_init()` and `cbuf_make()` */
 #define CBUF_MAX_CAPACITY SSIZE_MAX
+/* Upper bound of `sizeof(cbuf_t)`; the header spans at most 5 cache lines */
+#define CBUF_HDR_MAX_SIZE (5 * CACHELINE_SIZE)
+
+/* `cbuf_t.flags`: optional features that hook into the publish paths */
+#define CBUF_F_GROUP 0x01U /* member of a cbuf_group_t */
+#define CBUF_F_FILE 0x02U  /* storage mapped from a file */
+#define CBUF_F_WATERMARK 0x04U /* fill level watermark callbacks */
+#define CBUF_F_POOL 0x08U      /* storage owned by a cbuf_pool_t */
+#define CBUF_F_TEE 0x10U       /* consumed data is recorded to a file */
+#define CBUF_F_ADAPTIVE 0x20U  /* adaptive waiting, see below */
+
+/* Default cost of parking a waiting thread, see `cbuf_set_adaptive_wait()` */
+#ifndef CBUF_WAIT_PARK_NSEC
+#define CBUF_WAIT_PARK_NSEC 50000
+#endif
+
+struct cbuf_group_st;
+struct cbuf_file_hdr_st;
+struct cbuf_tee_st;
+struct cbuf_st;
+
+/**
+ * @struct cbuf_batch_t
+ * @brief Writer-side state for deferred publishing, see `cbuf_set_batching()`.
+ */
+typedef struct cbuf_batch_st {
+  bool enabled;
+  uint8_t *writep;    /* write position, ahead of the published `writep` */
+  size_t pending;     /* bytes written but not yet published */
+  size_t max_bytes;   /* publish once this many bytes are pending */
+  int64_t max_usec;   /* publish once the oldest pending write is this old */
+  int64_t begin_usec; /* time of the oldest pending write */
+} cbuf_batch_t;
+
+/* Watermark callback, see `cbuf_set_watermarks()` */
+typedef void (*cbuf_watermark_fn)(struct cbuf_st *cbuf, bool high, void *arg);
+
+/**
+ * @struct cbuf_watermark_t
+ * @brief Fill level watermarks, see `cbuf_set_watermarks()`.
+ */
+typedef struct cbuf_watermark_st {
+  size_t low;
+  size_t high;
+  cbuf_watermark_fn fn;
+  void *arg;
+  _Atomic(int) state; /* shared by the reader and the writer */
+} cbuf_watermark_t;
+
+/* The two sides of a cbuf */
+typedef enum cbuf_side_e {
+  CBUF_READER = 0,
+  CBUF_WRITER,
+} cbuf_side_t;
+
+/* How the adaptive waiter waits, see `cbuf_set_adaptive_wait()` */
+typedef enum cbuf_wait_mode_e {
+  CBUF_WAIT_SPIN = 0, /* busy-wait with pause instructions */
+  CBUF_WAIT_YIELD,    /* yield the processor on every retry */
+  CBUF_WAIT_SLEEP,    /* sleep for the park cost on every retry */
+  CBUF_WAIT_MODES,
+} cbuf_wait_mode_t;
+
+/**
+ * @struct cbuf_wait_stats_t
+ * @brief Adaptive wait state and decisions of one side of a cbuf.
+ */
+typedef struct cbuf_wait_stats_st {
+  int64_t ewma_nsec;                /* expected duration of the next wait */
+  uint64_t waits[CBUF_WAIT_MODES];  /* waits started in each mode */
+  cbuf_wait_mode_t last;            /* mode picked for the latest wait */
+} cbuf_wait_stats_t;
 
 /**
  * @struct cbuf_t
@@ -24,14 +116,64 @@
  * when advancing the write pointer would cause it to equal the read pointer
  * (one byte is always left unused). The buffer is considered empty when `readp
  * == writep`.
+ *
+ * - `flags` tells the read and write paths which optional features are
+ * enabled for this cbuf, so that a cbuf without any of them only pays for a
+ * single predictable branch.
+ *
+ * - Fields are grouped by owner, each group on its own cache line(s): the
+ * read-mostly configuration, then the reader's state, then the writer's
+ * state, so that a side updating its own state does not invalidate the lines
+ * the other side reads.
+ *
+ * - As a consequence `cbuf_t` is aligned to `CACHELINE_SIZE` and takes at
+ * most `CBUF_HDR_MAX_SIZE` bytes. Storage for one must be aligned as well:
+ * use `aligned_alloc(CACHELINE_SIZE, sizeof(cbuf_t))` rather than `malloc()`.
+ * Static, automatic and C++ `new` storage is aligned by the compiler. Types
+ * that embed a `cbuf_t` (`cbuf_prio_t`, `cbuf_tee_t`, `cbuf_pipeline_t`)
+ * inherit the requirement.
  */
 typedef struct cbuf_st {
+  /* read-mostly; only changed before the reader and the writer start */
   uint8_t *restrict buf;
-  _Atomic(uint8_t *) readp;
-  _Atomic(uint8_t *) writep;
   size_t capacity;
+  unsigned int flags;
+  /* cbuf_group.h */
+  struct cbuf_group_st *group;
+  uint64_t group_mask;
+  /* cbuf_file.h */
+  struct cbuf_file_hdr_st *file;
+  /* cbuf_tee.h */
+  struct cbuf_tee_st *tee;
+  /* flow control; `wm.state` only changes when a watermark is crossed */
+  cbuf_watermark_t wm;
+  /* adaptive waiting */
+  int64_t park_nsec;
+
+  /* owned by the reader */
+  _Alignas(CACHELINE_SIZE) _Atomic(uint8_t *) readp;
+  cbuf_wait_stats_t read_wait;
+
+  /* owned by the writer */
+  _Alignas(CACHELINE_SIZE) _Atomic(uint8_t *) writep;
+  cbuf_wait_stats_t write_wait;
+  /* deferred publishing */
+  cbuf_batch_t batch;
 } cbuf_t;
 
+/**
+ * @struct cbuf_segs_t
+ * @brief A zero-copy view of a region of a cbuf.
+ *
+ * A readable or writable region of a cbuf is split into at most two segments
+ * at the end of the internal buffer. `len[1]` is zero when the region does not
+ * wrap around.
+ */
+typedef struct cbuf_segs_st {
+  uint8_t *ptr[2];
+  size_t len[2];
+} cbuf_segs_t;
+
 int cbuf_init(cbuf_t *cbuf, size_t capacity);
 
 void cbuf_free(cbuf_t *cbuf);
@@ -50,12 +192,59 @@ ssize_t cbuf_get_readable_size(cbuf_t *cbuf);
 
 int cbuf_waitfor_readable(cbuf_t *cbuf, size_t nbytes, int64_t timeout_msec);
 
+int cbuf_waitfor_writable(cbuf_t *cbuf, size_t nbytes, int64_t timeout_msec);
+
+int cbuf_set_watermarks(cbuf_t *cbuf, size_t low, size_t high,
+                        cbuf_watermark_fn fn, void *arg);
+
+int cbuf_set_adaptive_wait(cbuf_t *cbuf, bool enable, int64_t park_nsec);
+
+int cbuf_get_wait_stats(cbuf_t *cbuf, cbuf_side_t side,
+                        cbuf_wait_stats_t *stats);
+
 ssize_t cbuf_write_blocking(cbuf_t *cbuf, const uint8_t *buf, size_t nbytes,
                             int64_t timeout_msec);
 
 ssize_t cbuf_read_blocking(cbuf_t *cbuf, uint8_t *buf, size_t nbytes,
                            int64_t timeout_msec, bool all);
 
+ssize_t cbuf_write_crc32c(cbuf_t *cbuf, const uint8_t *buf, size_t nbytes,
+                          int64_t timeout_msec, uint32_t *crc);
+
+ssize_t cbuf_read_crc32c(cbuf_t *cbuf, uint8_t *buf, size_t nbytes,
+                         int64_t timeout_msec, bool all, uint32_t *crc);
+
 ssize_t cbuf_peek(cbuf_t *cbuf, uint8_t *buf, size_t nbytes);
 
+ssize_t cbuf_peek_at(cbuf_t *cbuf, size_t offset, uint8_t *buf, size_t nbytes);
+
 ssize_t cbuf_remove(cbuf_t *cbuf, size_t nbytes);
+
+ssize_t cbuf_get_read_segs(cbuf_t *cbuf, cbuf_segs_t *segs);
+
+ssize_t cbuf_view_at(cbuf_t *cbuf, size_t offset, size_t len,
+                     cbuf_segs_t *segs);
+
+ssize_t cbuf_get_write_segs(cbuf_t *cbuf, cbuf_segs_t *segs);
+
+ssize_t cbuf_commit(cbuf_t *cbuf, size_t nbytes);
+
+int cbuf_set_batching(cbuf_t *cbuf, size_t max_bytes, int64_t max_usec);
+
+ssize_t cbuf_flush(cbuf_t *cbuf);
+
+ssize_t cbuf_find(cbuf_t *cbuf, const uint8_t *pat, size_t patlen);
+
+ssize_t cbuf_read_until(cbuf_t *cbuf, uint8_t *buf, size_t nbytes,
+                        const uint8_t *delim, size_t delimlen,
+                        int64_t timeout_msec);
+
+ssize_t cbuf_splice(cbuf_t *dst, cbuf_t *src, size_t nbytes,
+                    int64_t timeout_msec);
+
+#ifdef __cplusplus
+}
+#pragma pop_macro("restrict")
+#pragma pop_macro("_Atomic")
+#pragma pop_macro("_Alignas")
+#endif
@@ -0,0 +1,283 @@
+#pragma once
+
+/**
+ * Header-only C++17/20 interface for cbuf.
+ *
+ * Every member function is a thin inline forwarder to the C API in cbuf.h;
+ * there are no virtual calls and no intermediate copies. Timeouts are
+ * `std::chrono` durations; negative durations wait indefinitely, mirroring the
+ * `-1` timeout of the C API.
+ */
+
+#include "cbuf.h"
+
+#include <chrono>
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#if __cplusplus >= 202002L && __has_include(<span>)
+#include <span>
+#endif
+
+namespace cbuf {
+
+#if defined(__cpp_lib_span)
+template <class T> using span = std::span<T>;
+#else
+/**
+ * Minimal stand-in for `std::span` (C++20) so that this header also works in
+ * C++17 mode.
+ */
+template <class T> class span {
+public:
+  constexpr span() noexcept = default;
+  constexpr span(T *data, std::size_t size) noexcept
+      : data_(data), size_(size) {}
+  template <std::size_t N>
+  constexpr span(T (&arr)[N]) noexcept : data_(arr), size_(N) {}
+
+  constexpr T *data() const noexcept { return data_; }
+  constexpr std::size_t size() const noexcept { return size_; }
+  constexpr std::size_t size_bytes() const noexcept {
+    return size_ * sizeof(T);
+  }
+  constexpr bool empty() const noexcept { return size_ == 0; }
+  constexpr T *begin() const noexcept { return data_; }
+  constexpr T *end() const noexcept { return data_ + size_; }
+  constexpr T &operator[](std::size_t i) const noexcept { return data_[i]; }
+
+private:
+  T *data_ = nullptr;
+  std::size_t size_ = 0;
+};
+#endif
+
+/* Special timeout values, see `cbuf_write_blocking()` */
+inline constexpr std::chrono::milliseconds forever{-1};
+inline constexpr std::chrono::milliseconds nowait{0};
+
+namespace detail {
+
+template <class Rep, class Period>
+constexpr int64_t to_msec(std::chrono::duration<Rep, Period> d) noexcept {
+  using std::chrono::milliseconds;
+
+  if (d < d.zero())
+    return -1;
+  /* round up so that short non-zero timeouts do not turn into `nowait` */
+  auto ms = std::chrono::duration_cast<milliseconds>(d);
+  if (ms < d)
+    ++ms;
+  return static_cast<int64_t>(ms.count());
+}
+
+} // namespace detail
+
+/**
+ * @brief A zero-copy view of the readable or writable region of a ring, split
+ * into at most two segments at the end of the ring's internal buffer.
+ */
+class view {
+public:
+  view() noexcept : segs_{{nullptr, nullptr}, {0, 0}} {}
+  explicit view(const cbuf_segs_t &segs) noexcept : segs_(segs) {}
+
+  span<uint8_t> first() const noexcept { return {segs_.ptr[0], segs_.len[0]}; }
+  span<uint8_t> second() const noexcept {
+    return {segs_.ptr[1], segs_.len[1]};
+  }
+  std::size_t size() const noexcept { return segs_.len[0] + segs_.len[1]; }
+  bool empty() const noexcept { return size() == 0; }
+
+private:
+  cbuf_segs_t segs_;
+};
+
+/**
+ * @class ring
+ * @brief Move-only owner of a heap-allocated `cbuf_t`.
+ *
+ * The underlying `cbuf_t` has a stable address for the lifetime of the ring
+ * (moving a ring only moves the pointer), so `native_handle()` may be shared
+ * with C code. The same SPSC rules as `cbuf_t` apply: one thread may call the
+ * reader functions and one thread the writer functions concurrently.
+ */
+class ring {
+public:
+  ring() noexcept = default;
+
+  /**
+   * @param capacity The capacity in bytes.
+   *
+   * @throw std::invalid_argument if @p capacity is out of bounds.
+   * @throw std::bad_alloc if the allocation fails.
+   */
+  explicit ring(std::size_t capacity) {
+    if ((capacity < CBUF_MIN_CAPACITY) || (capacity > CBUF_MAX_CAPACITY))
+      throw std::invalid_argument("cbuf::ring: capacity out of bounds");
+
+    cbuf_ = new cbuf_t;
+    if (cbuf_init(cbuf_, capacity) != 0) {
+      delete cbuf_;
+      cbuf_ = nullptr;
+      throw std::bad_alloc();
+    }
+  }
+
+  ~ring() { reset(); }
+
+  ring(const ring &) = delete;
+  ring &operator=(const ring &) = delete;
+
+  ring(ring &&other) noexcept : cbuf_(std::exchange(other.cbuf_, nullptr)) {}
+  ring &operator=(ring &&other) noexcept {
+    if (this != &other) {
+      reset();
+      cbuf_ = std::exchange(other.cbuf_, nullptr);
+    }
+    return *this;
+  }
+
+  /* Free the ring; not thread safe */
+  void reset() noexcept {
+    if (cbuf_) {
+      cbuf_free(cbuf_);
+      delete cbuf_;
+      cbuf_ = nullptr;
+    }
+  }
+
+  explicit operator bool() const noexcept { return cbuf_ != nullptr; }
+  cbuf_t *native_handle() const noexcept { return cbuf_; }
+
+  std::size_t capacity() const noexcept { return cbuf_get_capacity(cbuf_); }
+  std::size_t readable_size() const noexcept {
+    return static_cast<std::size_t>(cbuf_get_readable_size(cbuf_));
+  }
+  bool empty() const noexcept { return cbuf_is_empty(cbuf_) > 0; }
+  bool full() const noexcept { return cbuf_is_full(cbuf_) > 0; }
+
+  template <class Rep = int64_t, class Period = std::milli>
+  bool wait_readable(std::size_t nbytes,
+                     std::chrono::duration<Rep, Period> timeout = forever) {
+    return cbuf_waitfor_readable(cbuf_, nbytes, detail::to_msec(timeout)) > 0;
+  }
+
+  /* See `cbuf_write_blocking()` */
+  template <class Rep = int64_t, class Period = std::milli>
+  ssize_t write(span<const uint8_t> buf,
+                std::chrono::duration<Rep, Period> timeout = forever) {
+    return cbuf_write_blocking(cbuf_, buf.data(), buf.size(),
+                               detail::to_msec(timeout));
+  }
+
+  /* See `cbuf_read_blocking()` */
+  template <class Rep = int64_t, class Period = std::milli>
+  ssize_t read(span<uint8_t> buf,
+               std::chrono::duration<Rep, Period> timeout = forever,
+               bool all = false) {
+    return cbuf_read_blocking(cbuf_, buf.data(), buf.size(),
+                              detail::to_msec(timeout), all);
+  }
+
+  ssize_t peek(span<uint8_t> buf) noexcept {
+    return cbuf_peek(cbuf_, buf.data(), buf.size());
+  }
+
+  ssize_t peek_at(std::size_t offset, span<uint8_t> buf) noexcept {
+    return cbuf_peek_at(cbuf_, offset, buf.data(), buf.size());
+  }
+
+  ssize_t remove(std::size_t nbytes) noexcept {
+    return cbuf_remove(cbuf_, nbytes);
+  }
+
+  /**
+   * @brief Write the object representation of @p value, all or nothing.
+   * @return true if @p value was written, false if the timeout expired.
+   */
+  template <class T, class Rep = int64_t, class Period = std::milli>
+  bool push(const T &value,
+            std::chrono::duration<Rep, Period> timeout = forever) {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "cbuf::ring::push requires a trivially copyable type");
+    return cbuf_write_blocking(cbuf_, reinterpret_cast<const uint8_t *>(&value),
+                               sizeof(T), detail::to_msec(timeout)) ==
+           static_cast<ssize_t>(sizeof(T));
+  }
+
+  /**
+   * @brief Read exactly `sizeof(T)` bytes into @p value.
+   * @return true if @p value was read, false if the timeout expired.
+   */
+  template <class T, class Rep = int64_t, class Period = std::milli>
+  bool pop(T &value, std::chrono::duration<Rep, Period> timeout = forever) {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "cbuf::ring::pop requires a trivially copyable type");
+    return cbuf_read_blocking(cbuf_, reinterpret_cast<uint8_t *>(&value),
+                              sizeof(T), detail::to_msec(timeout), true) ==
+           static_cast<ssize_t>(sizeof(T));
+  }
+
+  /**
+   * @brief Reader side zero-copy access; see `cbuf_get_read_segs()`.
+   * Consume the data with `consume()` once done with it.
+   */
+  view read_view() noexcept {
+    cbuf_segs_t segs;
+    if (cbuf_get_read_segs(cbuf_, &segs) < 0)
+      return view();
+    return view(segs);
+  }
+
+  /**
+   * @brief Reader side zero-copy access to at most @p len bytes starting
+   * @p offset bytes into the readable data; see `cbuf_view_at()`.
+   */
+  view view_at(std::size_t offset, std::size_t len) noexcept {
+    cbuf_segs_t segs;
+    if (cbuf_view_at(cbuf_, offset, len, &segs) < 0)
+      return view();
+    return view(segs);
+  }
+
+  /**
+   * @brief Consume @p nbytes of readable data; see `cbuf_remove()`.
+   * @return The number of bytes consumed, 0 on failure (e.g. on a moved-from
+   * ring).
+   */
+  std::size_t consume(std::size_t nbytes) noexcept {
+    ssize_t ret = cbuf_remove(cbuf_, nbytes);
+    return ret < 0 ? 0 : static_cast<std::size_t>(ret);
+  }
+
+  /**
+   * @brief Writer side zero-copy access; see `cbuf_get_write_segs()`.
+   * Publish the written data with `commit()`.
+   */
+  view write_view() noexcept {
+    cbuf_segs_t segs;
+    if (cbuf_get_write_segs(cbuf_, &segs) < 0)
+      return view();
+    return view(segs);
+  }
+
+  /**
+   * @brief Publish @p nbytes written through `write_view()`; see
+   * `cbuf_commit()`.
+   * @return The number of bytes published, 0 on failure (e.g. on a moved-from
+   * ring).
+   */
+  std::size_t commit(std::size_t nbytes) noexcept {
+    ssize_t ret = cbuf_commit(cbuf_, nbytes);
+    return ret < 0 ? 0 : static_cast<std::size_t>(ret);
+  }
+
+private:
+  cbuf_t *cbuf_ = nullptr;
+};
+
+} // namespace cbuf
@@ -0,0 +1,176 @@
+#include "cbuf_copy.h"
+
+#include <stdatomic.h>
+
+#if !defined(CBUF_NO_SIMD_COPY) && (defined(__x86_64__) || defined(__i386__))
+#define CBUF_HAVE_SIMD_COPY 1
+#include <immintrin.h>
+#endif
+
+typedef void (*copy_fn_t)(void *restrict, const void *restrict, size_t);
+
+size_t cbuf_copy_nt_threshold = CBUF_COPY_NT_THRESHOLD;
+
+static _Atomic(copy_fn_t) copy_large_fn;
+static _Atomic(cbuf_copy_kernel_t) copy_kernel;
+
+static void copy_memcpy(void *restrict dst, const void *restrict src,
+                        size_t n) {
+  memcpy(dst, src, n);
+}
+
+#ifdef CBUF_HAVE_SIMD_COPY
+/**
+ * Streaming copy kernels.
+ *
+ * Copy the unaligned head with `memcpy()` so that the destination is aligned
+ * to the vector width, stream the body with non-temporal stores, then copy
+ * the tail with `memcpy()`. Non-temporal stores are weakly ordered even on
+ * x86, so every kernel ends with an `sfence`.
+ */
+#define NT_COPY_KERNEL(name, attr, vec_t, width, load, stream)                 \
+  attr static void name(void *restrict dst, const void *restrict src,          \
+                        size_t n) {                                            \
+    uint8_t *d = dst;                                                          \
+    const uint8_t *s = src;                                                    \
+    size_t head = (width - ((uintptr_t)d & (width - 1))) & (width - 1);        \
+                                                                               \
+    head = MIN(head, n);                                                       \
+    memcpy(d, s, head);                                                        \
+    d += head;                                                                 \
+    s += head;                                                                 \
+    n -= head;                                                                 \
+                                                                               \
+    for (; n >= 4 * width; n -= 4 * width) {                                   \
+      vec_t v0 = load((const vec_t *)(s + 0 * width));                         \
+      vec_t v1 = load((const vec_t *)(s + 1 * width));                         \
+      vec_t v2 = load((const vec_t *)(s + 2 * width));                         \
+      vec_t v3 = load((const vec_t *)(s + 3 * width));                         \
+      stream((vec_t *)(d + 0 * width), v0);                                    \
+      stream((vec_t *)(d + 1 * width), v1);                                    \
+      stream((vec_t *)(d + 2 * width), v2);                                    \
+      stream((vec_t *)(d + 3 * width), v3);                                    \
+      s += 4 * width;                                                          \
+      d += 4 * width;                                                          \
+    }                                                                          \
+    for (; n >= width; n -= width) {                                           \
+      stream((vec_t *)d, load((const vec_t *)s));                              \
+      s += width;                                                              \
+      d += width;                                                              \
+    }                                                                          \
+    _mm_sfence();                                                              \
+    memcpy(d, s, n);                                                           \
+  }
+
+NT_COPY_KERNEL(copy_nt_sse2, __attribute__((target("sse2"))), __m128i, 16,
+               _mm_loadu_si128, _mm_stream_si128)
+NT_COPY_KERNEL(copy_nt_avx2, __attribute__((target("avx2"))), __m256i, 32,
+               _mm256_loadu_si256, _mm256_stream_si256)
+NT_COPY_KERNEL(copy_nt_avx512, __attribute__((target("avx512f"))), __m512i,
+               64, _mm512_loadu_si512, _mm512_stream_si512)
+#endif /* CBUF_HAVE_SIMD_COPY */
+
+static bool kernel_supported(cbuf_copy_kernel_t kernel) {
+  switch (kernel) {
+  case CBUF_COPY_MEMCPY:
+    return true;
+#ifdef CBUF_HAVE_SIMD_COPY
+  case CBUF_COPY_SSE2:
+    return __builtin_cpu_supports("sse2");
+  case CBUF_COPY_AVX2:
+    return __builtin_cpu_supports("avx2");
+  case CBUF_COPY_AVX512:
+    return __builtin_cpu_supports("avx512f");
+#endif
+  default:
+    return false;
+  }
+}
+
+static copy_fn_t kernel_fn(cbuf_copy_kernel_t kernel) {
+  switch (kernel) {
+#ifdef CBUF_HAVE_SIMD_COPY
+  case CBUF_COPY_SSE2:
+    return copy_nt_sse2;
+  case CBUF_COPY_AVX2:
+    return copy_nt_avx2;
+  case CBUF_COPY_AVX512:
+    return copy_nt_avx512;
+#endif
+  default:
+    return copy_memcpy;
+  }
+}
+
+/**
+ * @param[in] kernel The copy kernel to use for large copies.
+ * @return 0 on success, -1 if @p kernel is not supported by this CPU.
+ *
+ * @brief Select the kernel used for copies of at least
+ * `cbuf_copy_get_nt_threshold()` bytes into any cbuf. `CBUF_COPY_AUTO` selects
+ * the widest streaming kernel supported by this CPU; this is also what is used
+ * if this function is never called.
+ *
+ * @note Not thread safe! Select the kernel before starting any writers.
+ */
+int cbuf_copy_select(cbuf_copy_kernel_t kernel) {
+  if (kernel == CBUF_COPY_AUTO) {
+    if (kernel_supported(CBUF_COPY_AVX512))
+      kernel = CBUF_COPY_AVX512;
+    else if (kernel_supported(CBUF_COPY_AVX2))
+      kernel = CBUF_COPY_AVX2;
+    else if (kernel_supported(CBUF_COPY_SSE2))
+      kernel = CBUF_COPY_SSE2;
+    else
+      kernel = CBUF_COPY_MEMCPY;
+  }
+
+  if (!kernel_supported(kernel))
+    return -1;
+
+  atomic_store_explicit(&copy_kernel, kernel, memory_order_relaxed);
+  atomic_store_explicit(&copy_large_fn, kernel_fn(kernel),
+                        memory_order_relaxed);
+  return 0;
+}
+
+/**
+ * @return The kernel currently used for large copies.
+ *
+ * @brief Get the copy kernel in use, resolving `CBUF_COPY_AUTO` if no kernel
+ * was selected yet.
+ */
+cbuf_copy_kernel_t cbuf_copy_get_kernel(void) {
+  if (!atomic_load_explicit(&copy_large_fn, memory_order_relaxed))
+    (void)cbuf_copy_select(CBUF_COPY_AUTO);
+
+  return atomic_load_explicit(&copy_kernel, memory_order_relaxed);
+}
+
+/**
+ * @param[in] nbytes The new threshold in bytes; `SIZE_MAX` disables the large
+ * copy kernel entirely.
+ *
+ * @brief Set the size from which copies into a cbuf use the large copy kernel.
+ *
+ * @note Not thread safe! Set the threshold before starting any writers.
+ */
+void cbuf_copy_set_nt_threshold(size_t nbytes) {
+  cbuf_copy_nt_threshold = nbytes;
+}
+
+/**
+ * @return The current large copy threshold in bytes.
+ */
+size_t cbuf_copy_get_nt_threshold(void) { return cbuf_copy_nt_threshold; }
+
+void cbuf_copy_large(void *restrict dst, const void *restrict src, size_t n) {
+  copy_fn_t fn = atomic_load_explicit(&copy_large_fn, memory_order_relaxed);
+
+  if (unlikely(!fn)) {
+    (void)cbuf_copy_select(CBUF_COPY_AUTO);
+    fn = atomic_load_explicit(&copy_large_fn, memory_order_relaxed);
+  }
+
+  fn(dst, src, n);
+}
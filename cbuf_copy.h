@@ -0,0 +1,92 @@
+#pragma once
+
+#include "defs.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Copies at least this large (in bytes) into a cbuf use the non-temporal
+ * (streaming store) copy kernel, which writes around the producer's caches
+ * instead of pulling every destination line into them. Smaller copies always
+ * go through `memcpy()`. Can be overridden at build time, or at runtime with
+ * `cbuf_copy_set_nt_threshold()`.
+ */
+#ifndef CBUF_COPY_NT_THRESHOLD
+#define CBUF_COPY_NT_THRESHOLD (1U << 20)
+#endif
+
+/**
+ * Number of bytes of the next readable span the reader prefetches after each
+ * read. Set to 0 at build time to disable consumer-side prefetching.
+ */
+#ifndef CBUF_COPY_PREFETCH_BYTES
+#define CBUF_COPY_PREFETCH_BYTES (4 * CACHELINE_SIZE)
+#endif
+
+/**
+ * @enum cbuf_copy_kernel_t
+ * @brief Copy kernels used for large copies into a cbuf.
+ */
+typedef enum cbuf_copy_kernel_e {
+  CBUF_COPY_AUTO = 0, /* widest kernel supported by this CPU */
+  CBUF_COPY_MEMCPY,   /* plain `memcpy()`, no streaming stores */
+  CBUF_COPY_SSE2,     /* 16-byte streaming stores */
+  CBUF_COPY_AVX2,     /* 32-byte streaming stores */
+  CBUF_COPY_AVX512,   /* 64-byte streaming stores */
+} cbuf_copy_kernel_t;
+
+int cbuf_copy_select(cbuf_copy_kernel_t kernel);
+
+cbuf_copy_kernel_t cbuf_copy_get_kernel(void);
+
+void cbuf_copy_set_nt_threshold(size_t nbytes);
+
+size_t cbuf_copy_get_nt_threshold(void);
+
+/* Dispatched large-copy kernel; use `cbuf_copy_in()` instead */
+void cbuf_copy_large(void *restrict dst, const void *restrict src, size_t n);
+
+extern size_t cbuf_copy_nt_threshold;
+
+/**
+ * cbuf_copy_in(dst, src, n)
+ * @brief Copy @p n bytes from a user buffer into a cbuf.
+ *
+ * The size check is inlined so that the common small copy costs no more than
+ * a `memcpy()`. The streaming kernels end with a store fence, so a subsequent
+ * release store of the write pointer orders the data before it.
+ */
+INLINE void cbuf_copy_in(void *restrict dst, const void *restrict src,
+                         size_t n) {
+  if (likely(n < cbuf_copy_nt_threshold))
+    memcpy(dst, src, n);
+  else
+    cbuf_copy_large(dst, src, n);
+}
+
+/**
+ * cbuf_copy_prefetch(p, n)
+ * @brief Prefetch up to `CBUF_COPY_PREFETCH_BYTES` of the @p n bytes at @p p
+ * for reading.
+ */
+INLINE void cbuf_copy_prefetch(const uint8_t *p, size_t n) {
+#if (CBUF_COPY_PREFETCH_BYTES > 0) && (defined(__GNUC__) || defined(__clang__))
+  size_t i;
+
+  n = MIN(n, (size_t)CBUF_COPY_PREFETCH_BYTES);
+  for (i = 0; i < n; i += CACHELINE_SIZE)
+    __builtin_prefetch(p + i, 0, 3);
+#else
+  (void)p;
+  (void)n;
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
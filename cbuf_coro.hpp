@@ -0,0 +1,276 @@
+#pragma once
+
+/**
+ * C++20 coroutine awaitables for cbuf.
+ *
+ * `cbuf::async_ring` attaches to a `cbuf::ring` and provides `async_read()`
+ * and `async_write()` awaitables. Instead of spinning, a coroutine that finds
+ * the ring empty (reader) or too full (writer) parks its handle in the
+ * async_ring and suspends; the other side resumes it from its own publish
+ * path after consuming or committing data. No syscalls are involved, so one
+ * executor thread can multiplex any number of rings.
+ *
+ * - Both ends must go through the same `async_ring` for wakeups to happen; a
+ * plain `cbuf_write_blocking()` on the ring will not resume a parked reader.
+ *
+ * - The SPSC rules still apply: at most one coroutine may await
+ * `async_read()` and one coroutine `async_write()` at a time.
+ *
+ * - Parked coroutines are resumed through a user supplied `resume_fn`, which
+ * would typically post the handle to an executor queue. By default they are
+ * resumed on the waking thread through a trampoline: the first wakeup resumes
+ * inline, and wakeups issued by coroutines it resumes are queued and run once
+ * it suspends, so a chain of wakeups never nests more than one resume deep.
+ */
+
+#include "cbuf.hpp"
+
+#if !defined(__cpp_impl_coroutine) || !__has_include(<coroutine>)
+#error "cbuf_coro.hpp requires C++20 coroutines"
+#endif
+
+#include <atomic>
+#include <coroutine>
+#include <cstring>
+
+namespace cbuf {
+
+using resume_fn = void (*)(std::coroutine_handle<> h, void *arg);
+
+class async_ring {
+  /* A parked coroutine and the amount of data/space it is waiting for */
+  struct waiter {
+    std::atomic<void *> handle{nullptr};
+    std::atomic<std::size_t> need{0};
+    /* Inline resume queue; only touched by the waking thread */
+    void *queued = nullptr;
+    waiter *next = nullptr;
+  };
+
+  /* Per-thread FIFO of woken waiters for inline resumes */
+  struct trampoline {
+    waiter *head = nullptr;
+    waiter *tail = nullptr;
+    bool running = false;
+  };
+
+public:
+  /**
+   * @param r The ring to attach to; must outlive this object.
+   * @param fn Function used to resume parked coroutines, or `nullptr` to
+   * resume them inline.
+   * @param arg Opaque argument passed to @p fn.
+   */
+  explicit async_ring(ring &r, resume_fn fn = nullptr,
+                      void *arg = nullptr) noexcept
+      : cbuf_(r.native_handle()), resume_(fn), arg_(arg) {}
+
+  async_ring(const async_ring &) = delete;
+  async_ring &operator=(const async_ring &) = delete;
+
+  class read_awaitable;
+  class write_awaitable;
+
+  /**
+   * @brief Read at most `buf.size()` bytes, suspending until at least one byte
+   * is readable.
+   *
+   * `co_await` yields the number of bytes read (>0), or -1 for invalid
+   * arguments.
+   */
+  read_awaitable async_read(span<uint8_t> buf) noexcept { return {*this, buf}; }
+
+  /**
+   * @brief Write all of `buf`, suspending until there is enough free space.
+   *
+   * `co_await` yields `buf.size()`, or -1 if `buf` can never fit in the ring.
+   */
+  write_awaitable async_write(span<const uint8_t> buf) noexcept {
+    return {*this, buf};
+  }
+
+  class read_awaitable {
+  public:
+    read_awaitable(async_ring &ar, span<uint8_t> buf) noexcept
+        : ar_(ar), buf_(buf) {}
+
+    bool await_ready() noexcept {
+      if (!ar_.cbuf_ || buf_.empty())
+        return true;
+      return cbuf_get_readable_size(ar_.cbuf_) > 0;
+    }
+
+    bool await_suspend(std::coroutine_handle<> h) noexcept {
+      return ar_.park(ar_.reader_, h, 1, &async_ring::readable);
+    }
+
+    ssize_t await_resume() noexcept {
+      if (!ar_.cbuf_ || buf_.empty())
+        return -1;
+      return ar_.try_read(buf_);
+    }
+
+  private:
+    async_ring &ar_;
+    span<uint8_t> buf_;
+  };
+
+  class write_awaitable {
+  public:
+    write_awaitable(async_ring &ar, span<const uint8_t> buf) noexcept
+        : ar_(ar), buf_(buf) {}
+
+    bool await_ready() noexcept {
+      if (!ar_.cbuf_ || (buf_.size() > cbuf_get_capacity(ar_.cbuf_)))
+        return true;
+      return writable(ar_.cbuf_) >= buf_.size();
+    }
+
+    bool await_suspend(std::coroutine_handle<> h) noexcept {
+      return ar_.park(ar_.writer_, h, buf_.size(), &async_ring::writable);
+    }
+
+    ssize_t await_resume() noexcept {
+      if (!ar_.cbuf_ || (buf_.size() > cbuf_get_capacity(ar_.cbuf_)))
+        return -1;
+      return ar_.try_write(buf_);
+    }
+
+  private:
+    async_ring &ar_;
+    span<const uint8_t> buf_;
+  };
+
+private:
+  static std::size_t readable(cbuf_t *cbuf) noexcept {
+    return static_cast<std::size_t>(cbuf_get_readable_size(cbuf));
+  }
+
+  static std::size_t writable(cbuf_t *cbuf) noexcept {
+    return cbuf_get_capacity(cbuf) - readable(cbuf);
+  }
+
+  /**
+   * Publish @p h in @p w, then re-check the ring so that a wakeup racing with
+   * the publication is not lost: the other side always checks for a parked
+   * waiter after its own publish, and the seq_cst fences on both sides
+   * guarantee that at least one of the two sees the other's update.
+   *
+   * Nothing reachable through the awaiter is touched after the handle is
+   * published, since the coroutine may be resumed (and the awaiter destroyed)
+   * by the other side at any point after that.
+   *
+   * @return false if the coroutine should not suspend after all.
+   */
+  bool park(waiter &w, std::coroutine_handle<> h, std::size_t need,
+            std::size_t (*avail)(cbuf_t *)) noexcept {
+    cbuf_t *cbuf = cbuf_;
+
+    w.need.store(need, std::memory_order_relaxed);
+    w.handle.store(h.address(), std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (avail(cbuf) >= need) {
+      /* If the handle is gone, the other side already owns the wakeup */
+      if (w.handle.exchange(nullptr, std::memory_order_acq_rel))
+        return false;
+    }
+    return true;
+  }
+
+  /* Resume the coroutine parked in @p w if @p avail satisfies it */
+  void wake(waiter &w, std::size_t (*avail)(cbuf_t *)) noexcept {
+    void *addr;
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!w.handle.load(std::memory_order_acquire))
+      return;
+    if (avail(cbuf_) < w.need.load(std::memory_order_relaxed))
+      return;
+
+    addr = w.handle.exchange(nullptr, std::memory_order_acq_rel);
+    if (!addr)
+      return;
+
+    if (resume_)
+      resume_(std::coroutine_handle<>::from_address(addr), arg_);
+    else
+      resume_inline(w, addr);
+  }
+
+  /**
+   * Resume @p addr on this thread. A resume issued from a coroutine that is
+   * itself being resumed here is queued instead, and run by the outermost
+   * call once that coroutine suspends. The woken coroutine cannot park on
+   * @p w again before it runs, so @p w is free to link it.
+   */
+  static void resume_inline(waiter &w, void *addr) noexcept {
+    static thread_local trampoline t;
+    waiter *q;
+
+    w.queued = addr;
+    w.next = nullptr;
+    if (t.tail)
+      t.tail->next = &w;
+    else
+      t.head = &w;
+    t.tail = &w;
+
+    if (t.running)
+      return;
+
+    t.running = true;
+    while ((q = t.head)) {
+      t.head = q->next;
+      if (!t.head)
+        t.tail = nullptr;
+      /* `q` may be reused as soon as its coroutine runs */
+      addr = q->queued;
+      std::coroutine_handle<>::from_address(addr).resume();
+    }
+    t.running = false;
+  }
+
+  ssize_t try_read(span<uint8_t> buf) noexcept {
+    cbuf_segs_t segs;
+    std::size_t n, len;
+
+    if (cbuf_get_read_segs(cbuf_, &segs) <= 0)
+      return 0;
+
+    n = MIN(segs.len[0] + segs.len[1], buf.size());
+    len = MIN(segs.len[0], n);
+    std::memcpy(buf.data(), segs.ptr[0], len);
+    if (n - len)
+      std::memcpy(buf.data() + len, segs.ptr[1], n - len);
+
+    cbuf_remove(cbuf_, n);
+    wake(writer_, &async_ring::writable);
+    return static_cast<ssize_t>(n);
+  }
+
+  ssize_t try_write(span<const uint8_t> buf) noexcept {
+    cbuf_segs_t segs;
+    std::size_t len;
+
+    if (cbuf_get_write_segs(cbuf_, &segs) < static_cast<ssize_t>(buf.size()))
+      return 0;
+
+    len = MIN(segs.len[0], buf.size());
+    std::memcpy(segs.ptr[0], buf.data(), len);
+    if (buf.size() - len)
+      std::memcpy(segs.ptr[1], buf.data() + len, buf.size() - len);
+
+    cbuf_commit(cbuf_, buf.size());
+    wake(reader_, &async_ring::readable);
+    return static_cast<ssize_t>(buf.size());
+  }
+
+  cbuf_t *cbuf_;
+  resume_fn resume_;
+  void *arg_;
+  waiter reader_;
+  waiter writer_;
+};
+
+} // namespace cbuf
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "defs.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * CRC32C (Castagnoli) checksums.
+ *
+ * All functions follow the zlib `crc32()` convention: pass 0 as the initial
+ * @p crc, and pass the previous result to continue a checksum over several
+ * buffers, so that `crc(crc(0, a), b) == crc(0, a || b)`.
+ *
+ * The SSE4.2 `crc32` instruction is used when the CPU supports it, and a
+ * table driven implementation otherwise.
+ */
+
+uint32_t cbuf_crc32c(uint32_t crc, const void *buf, size_t n);
+
+uint32_t cbuf_crc32c_copy(uint32_t crc, void *restrict dst,
+                          const void *restrict src, size_t n);
+
+int cbuf_crc32c_set_hw(bool enable);
+
+#ifdef __cplusplus
+}
+#endif
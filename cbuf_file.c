@@ -0,0 +1,199 @@
+#include "cbuf_file.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+
+/**
+ * @param[in] cbuf An uninitialized cbuf instance.
+ * @param[in] path The backing file.
+ * @param[in] capacity The capacity in bytes of a new file, or 0 to only open
+ * an existing one.
+ * @return 0 on success, -1 on failure.
+ *
+ * @brief Initialize @p cbuf with its storage mapped from the file at @p path.
+ *
+ * - If the file does not exist (or is empty), it is created with room for
+ * @p capacity bytes of data and an empty ring.
+ *
+ * - Otherwise the ring is recovered from the file as of the last
+ * `cbuf_sync()`. If @p capacity is not 0, it must match the file.
+ *
+ * Reads and writes are plain memory copies into the shared mapping; nothing
+ * is written back to the file until `cbuf_sync()`. Use `cbuf_close_file()` (or
+ * `cbuf_free()`) to close the file; `cbuf_release()` must not be used.
+ */
+int cbuf_open_file(cbuf_t *cbuf, const char *path, size_t capacity) {
+  cbuf_file_hdr_t *hdr;
+  struct stat st;
+  uint8_t *base;
+  size_t maplen;
+  bool create;
+  int fd;
+
+  if (!cbuf || !path)
+    return -1;
+
+  if (capacity && ((capacity < CBUF_MIN_CAPACITY) ||
+                   (capacity > CBUF_MAX_CAPACITY - CBUF_FILE_HDR_SIZE)))
+    return -1;
+
+  fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return -1;
+
+  if (fstat(fd, &st) != 0)
+    goto err;
+
+  create = (st.st_size == 0);
+  if (create) {
+    if (!capacity)
+      goto err;
+    maplen = CBUF_FILE_HDR_SIZE + capacity;
+    if (ftruncate(fd, maplen) != 0)
+      goto err;
+  } else {
+    if ((size_t)st.st_size < CBUF_FILE_HDR_SIZE + CBUF_MIN_CAPACITY)
+      goto err;
+    maplen = st.st_size;
+    if (capacity && (maplen != CBUF_FILE_HDR_SIZE + capacity))
+      goto err;
+  }
+
+  base = mmap(NULL, maplen, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED)
+    goto err;
+  /* The mapping keeps the file referenced */
+  close(fd);
+
+  hdr = (cbuf_file_hdr_t *)base;
+  if (create) {
+    hdr->magic = CBUF_FILE_MAGIC;
+    hdr->version = CBUF_FILE_VERSION;
+    hdr->reserved = 0;
+    hdr->capacity = capacity;
+    hdr->read_off = 0;
+    hdr->write_off = 0;
+    (void)msync(base, CBUF_FILE_HDR_SIZE, MS_SYNC);
+  } else if ((hdr->magic != CBUF_FILE_MAGIC) ||
+             (hdr->version != CBUF_FILE_VERSION) ||
+             (hdr->capacity != maplen - CBUF_FILE_HDR_SIZE) ||
+             (hdr->read_off >= hdr->capacity) ||
+             (hdr->write_off >= hdr->capacity)) {
+    munmap(base, maplen);
+    return -1;
+  }
+
+  if (cbuf_make(cbuf, base + CBUF_FILE_HDR_SIZE, hdr->capacity) != 0) {
+    munmap(base, maplen);
+    return -1;
+  }
+
+  atomic_init(&cbuf->readp, cbuf->buf + hdr->read_off);
+  atomic_init(&cbuf->writep, cbuf->buf + hdr->write_off);
+  cbuf->file = hdr;
+  cbuf->flags |= CBUF_F_FILE;
+
+  return 0;
+
+err:
+  close(fd);
+  return -1;
+}
+
+/**
+ * @param[in] cbuf A file-backed cbuf. See `cbuf_open_file()`.
+ * @return 0 on success, -1 on failure.
+ *
+ * @brief Persist the data and the read/write offsets of @p cbuf.
+ *
+ * The offsets are snapshotted, the data is flushed, and only then the header
+ * is updated and flushed, so the header never refers to data that is not on
+ * disk. Sync as often as the application can afford to lose data; the
+ * read/write paths never touch the file themselves.
+ *
+ * @note Must be called by the reader. The read pointer is then stable, so
+ * the writer (which may keep running) can only write past the snapshot of
+ * the write pointer, never into the `[read_off, write_off)` range being
+ * recorded. Called from any other thread, the reader could free space that
+ * the writer overwrites between the two loads, and the header would describe
+ * newer data than was consumed. Must not be called concurrently with
+ * `cbuf_close_file()`.
+ */
+int cbuf_sync(cbuf_t *cbuf) {
+  cbuf_file_hdr_t *hdr;
+  uint8_t *readp, *writep;
+  int ret = 0;
+
+  if (!cbuf || !(cbuf->flags & CBUF_F_FILE))
+    return -1;
+
+  hdr = cbuf->file;
+  /* Owned by the caller, see above */
+  readp = atomic_load_explicit(&cbuf->readp, memory_order_relaxed);
+  writep = atomic_load_explicit(&cbuf->writep, memory_order_acquire);
+
+  if (msync(hdr, CBUF_FILE_HDR_SIZE + cbuf->capacity, MS_SYNC) != 0)
+    ret = -1;
+
+  hdr->read_off = (uint64_t)(readp - cbuf->buf);
+  hdr->write_off = (uint64_t)(writep - cbuf->buf);
+
+  if (msync(hdr, CBUF_FILE_HDR_SIZE, MS_SYNC) != 0)
+    ret = -1;
+
+  return ret;
+}
+
+/**
+ * @param[in] cbuf A file-backed cbuf. See `cbuf_open_file()`.
+ * @return 0 on success, -1 if the final sync failed or for invalid arguments.
+ *
+ * @brief Sync and unmap @p cbuf. The cbuf is unmapped even if the sync fails.
+ *
+ * @note Not thread safe!
+ */
+int cbuf_close_file(cbuf_t *cbuf) {
+  int ret;
+
+  if (!cbuf || !(cbuf->flags & CBUF_F_FILE))
+    return -1;
+
+  ret = cbuf_sync(cbuf);
+  munmap(cbuf->file, CBUF_FILE_HDR_SIZE + cbuf->capacity);
+
+  cbuf->flags &= ~CBUF_F_FILE;
+  cbuf->file = NULL;
+  cbuf->buf = NULL;
+  cbuf->capacity = 0;
+  atomic_store(&cbuf->readp, NULL);
+  atomic_store(&cbuf->writep, NULL);
+
+  return ret;
+}
+
+#else /* !__linux__ */
+
+int cbuf_open_file(cbuf_t *cbuf, const char *path, size_t capacity) {
+  (void)cbuf;
+  (void)path;
+  (void)capacity;
+  return -1;
+}
+
+int cbuf_sync(cbuf_t *cbuf) {
+  (void)cbuf;
+  return -1;
+}
+
+int cbuf_close_file(cbuf_t *cbuf) {
+  (void)cbuf;
+  return -1;
+}
+
+#endif /* __linux__ */
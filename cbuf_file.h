@@ -0,0 +1,39 @@
+#pragma once
+
+#include "cbuf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CBUF_FILE_MAGIC 0x46554243454C4946ULL /* "FILECBUF" */
+#define CBUF_FILE_VERSION 1U
+/* The data follows the header at this offset in the file */
+#define CBUF_FILE_HDR_SIZE 4096U
+
+/**
+ * @struct cbuf_file_hdr_t
+ * @brief On-disk header of a file-backed cbuf.
+ *
+ * `read_off` and `write_off` are only updated by `cbuf_sync()`, so after a
+ * crash the ring is recovered as of the last sync: data written after it is
+ * lost, and data consumed after it is read again (at-least-once delivery).
+ */
+typedef struct cbuf_file_hdr_st {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t capacity;
+  uint64_t read_off;
+  uint64_t write_off;
+} cbuf_file_hdr_t;
+
+int cbuf_open_file(cbuf_t *cbuf, const char *path, size_t capacity);
+
+int cbuf_sync(cbuf_t *cbuf);
+
+int cbuf_close_file(cbuf_t *cbuf);
+
+#ifdef __cplusplus
+}
+#endif
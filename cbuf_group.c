@@ -0,0 +1,226 @@
+#include "cbuf_group.h"
+#include "cbuf_timeout.h"
+#include "cbuf_wait.h"
+
+#include <string.h>
+
+/**
+ * @param[in] group The group to initialize.
+ * @return 0 on success, -1 for invalid arguments.
+ *
+ * @brief Initialize an empty cbuf group.
+ */
+int cbuf_group_init(cbuf_group_t *group) {
+  if (!group)
+    return -1;
+
+  atomic_init(&group->ready, 0);
+  group->members = 0;
+  group->pending = 0;
+  memset(group->cbufs, 0, sizeof(group->cbufs));
+  group->park_nsec = 0;
+  memset(&group->wait, 0, sizeof(group->wait));
+
+  return 0;
+}
+
+/**
+ * @param[in] group An initialized cbuf group.
+ * @param[in] cbuf An initialized cbuf instance that is not in any group.
+ * @return The index of @p cbuf in @p group (its bit in the bitmap returned by
+ * `cbuf_group_wait()`), or -1 if the group is full or for invalid arguments.
+ *
+ * @brief Add @p cbuf to @p group.
+ *
+ * @note Not thread safe! Add a cbuf before its producer starts writing.
+ */
+int cbuf_group_add(cbuf_group_t *group, cbuf_t *cbuf) {
+  unsigned int i;
+
+  if (!group || !cbuf || cbuf->group)
+    return -1;
+
+  if (!~group->members)
+    return -1;
+
+  for (i = 0; group->members & (1ULL << i); i++)
+    ;
+
+  group->cbufs[i] = cbuf;
+  group->members |= 1ULL << i;
+  cbuf->group = group;
+  cbuf->group_mask = 1ULL << i;
+  cbuf->flags |= CBUF_F_GROUP;
+
+  /* It may already hold data */
+  group->pending |= 1ULL << i;
+
+  return i;
+}
+
+/**
+ * @param[in] group An initialized cbuf group.
+ * @param[in] cbuf A member of @p group.
+ * @return 0 on success, -1 for invalid arguments.
+ *
+ * @brief Remove @p cbuf from @p group.
+ *
+ * @note Not thread safe! Remove a cbuf only while its producer is not writing.
+ */
+int cbuf_group_remove(cbuf_group_t *group, cbuf_t *cbuf) {
+  uint64_t mask;
+
+  if (!group || !cbuf || (cbuf->group != group))
+    return -1;
+
+  mask = cbuf->group_mask;
+  group->members &= ~mask;
+  group->pending &= ~mask;
+  group->cbufs[__builtin_ctzll(mask)] = NULL;
+  atomic_fetch_and_explicit(&group->ready, ~mask, memory_order_relaxed);
+
+  cbuf->flags &= ~CBUF_F_GROUP;
+  cbuf->group = NULL;
+  cbuf->group_mask = 0;
+
+  return 0;
+}
+
+/**
+ * @param[in] group An initialized cbuf group.
+ * @param[in] index A bit index from the bitmap returned by `cbuf_group_wait()`.
+ * @return The member cbuf at @p index, or NULL if there is none.
+ */
+cbuf_t *cbuf_group_get(cbuf_group_t *group, unsigned int index) {
+  if (!group || (index >= CBUF_GROUP_MAX))
+    return NULL;
+
+  return group->cbufs[index];
+}
+
+/**
+ * @param[in] group An initialized cbuf group.
+ * @param[out] ready Bitmap of the members with data to read; bit `i` stands
+ * for `cbuf_group_get(group, i)`.
+ * @param[in] timeout_msec The wait timeout (in milliseconds).
+ * @return The number of ready members, 0 if the timeout expired, or -1 for
+ * invalid arguments.
+ *
+ * @brief Wait for at most @p timeout_msec ms for any member of @p group to
+ * become readable. Must only be called by the consumer.
+ *
+ * The following values of @p timeout_msec are special:
+ *
+ * - `0`: return immediately
+ *
+ * - `-1`: wait indefinitely
+ */
+int cbuf_group_wait(cbuf_group_t *group, uint64_t *ready,
+                    int64_t timeout_msec) {
+  uint64_t bits, pending, mask;
+  cbuf_timeout_t timeout;
+  cbuf_waiter_t waiter;
+
+  if (!group || !ready)
+    return -1;
+
+  /**
+   * Members reported last time are ready again if they still hold data. The
+   * fence pairs with the one in `cbuf_group_notify()`: either the producer
+   * sees our latest read pointer and raises the ready bit, or we see its
+   * write pointer here.
+   */
+  atomic_thread_fence(memory_order_seq_cst);
+  pending = 0;
+  for (bits = group->pending; bits; bits &= bits - 1) {
+    mask = bits & -bits;
+    if (!cbuf_is_empty(group->cbufs[__builtin_ctzll(mask)]))
+      pending |= mask;
+  }
+
+  cbuf_waiter_init(&waiter, group->park_nsec ? &group->wait : NULL,
+                   group->park_nsec);
+  cbuf_timeout_begin(&timeout, timeout_msec);
+  for (;;) {
+    bits = pending;
+    /* Only pay for the exchange if some producer raised a bit */
+    if (atomic_load_explicit(&group->ready, memory_order_relaxed))
+      bits |= atomic_exchange_explicit(&group->ready, 0, memory_order_acquire);
+    bits &= group->members;
+
+    if (bits)
+      break;
+
+    if (cbuf_timeout_expired(&timeout))
+      break;
+
+    cbuf_waiter_wait(&waiter);
+  }
+  cbuf_waiter_end(&waiter);
+
+  group->pending = bits;
+  *ready = bits;
+  return __builtin_popcountll(bits);
+}
+
+/**
+ * @param[in] group An initialized cbuf group.
+ * @param[in] enable Enable or disable adaptive waiting.
+ * @param[in] park_nsec The cost of parking the consumer (in nanoseconds), or
+ * 0 for `CBUF_WAIT_PARK_NSEC`.
+ * @return 0 on success, -1 for invalid arguments.
+ *
+ * @brief Let `cbuf_group_wait()` pick how to wait from the waits it saw
+ * before, like `cbuf_set_adaptive_wait()` does for a single cbuf. The
+ * statistics are kept for the group as a whole, since the consumer waits for
+ * any member. Enabling resets them.
+ *
+ * @note Not thread safe! Configure this before starting the consumer.
+ */
+int cbuf_group_set_adaptive_wait(cbuf_group_t *group, bool enable,
+                                 int64_t park_nsec) {
+  if (!group || (park_nsec < 0))
+    return -1;
+
+  if (!enable) {
+    group->park_nsec = 0;
+    return 0;
+  }
+
+  group->park_nsec = park_nsec ? park_nsec : CBUF_WAIT_PARK_NSEC;
+  memset(&group->wait, 0, sizeof(group->wait));
+  return 0;
+}
+
+/**
+ * @param[in] group An initialized cbuf group.
+ * @param[out] stats The expected wait and the decisions made so far.
+ * @return 0 on success, -1 for invalid arguments.
+ *
+ * @brief Get the adaptive wait statistics of the consumer of @p group, see
+ * `cbuf_group_set_adaptive_wait()`. Call this from the consumer's thread, or
+ * once it has stopped, for a consistent snapshot.
+ */
+int cbuf_group_get_wait_stats(cbuf_group_t *group, cbuf_wait_stats_t *stats) {
+  if (!group || !stats)
+    return -1;
+
+  *stats = group->wait;
+  return 0;
+}
+
+/**
+ * Raise the ready bit of @p cbuf if the write just published turned it from
+ * empty to non-empty, i.e. if the reader had consumed everything up to the
+ * previous write pointer @p old_writep.
+ */
+void cbuf_group_notify(cbuf_t *cbuf, uint8_t *old_writep) {
+  uint8_t *readp;
+
+  atomic_thread_fence(memory_order_seq_cst);
+  readp = atomic_load_explicit(&cbuf->readp, memory_order_relaxed);
+
+  if (readp == old_writep)
+    atomic_fetch_or_explicit(&cbuf->group->ready, cbuf->group_mask,
+                             memory_order_release);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "cbuf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Max number of cbufs in a group; one bit of the ready word per member */
+#define CBUF_GROUP_MAX 64U
+
+/**
+ * @struct cbuf_group_t
+ * @brief A set of SPSC cbufs with a common consumer.
+ *
+ * Lets one consumer thread wait on up to `CBUF_GROUP_MAX` cbufs, each with
+ * its own producer, without polling every member.
+ *
+ * - Each member owns one bit of the shared `ready` word. A producer sets its
+ * bit when it publishes data into a member that was empty (the empty to
+ * non-empty edge), so writes into a cbuf that already has unread data cost
+ * nothing extra.
+ *
+ * - `cbuf_group_wait()` collects and clears the ready bits in one atomic
+ * exchange and returns them as a bitmap. Members returned by the previous
+ * call are re-checked on the next one, so data left behind by a partial read
+ * (or published while the consumer was still draining) is never missed.
+ *
+ * - The consumer should only read from the members reported ready.
+ *
+ * - The consumer's waits in `cbuf_group_wait()` may be adaptive, see
+ * `cbuf_group_set_adaptive_wait()`.
+ */
+typedef struct cbuf_group_st {
+  /* written by the producers */
+  _Alignas(CACHELINE_SIZE) _Atomic(uint64_t) ready;
+  /* only used by the consumer */
+  _Alignas(CACHELINE_SIZE) uint64_t members;
+  uint64_t pending;
+  cbuf_t *cbufs[CBUF_GROUP_MAX];
+  int64_t park_nsec; /* 0 unless adaptive waiting is enabled */
+  cbuf_wait_stats_t wait;
+} cbuf_group_t;
+
+int cbuf_group_init(cbuf_group_t *group);
+
+int cbuf_group_add(cbuf_group_t *group, cbuf_t *cbuf);
+
+int cbuf_group_remove(cbuf_group_t *group, cbuf_t *cbuf);
+
+cbuf_t *cbuf_group_get(cbuf_group_t *group, unsigned int index);
+
+int cbuf_group_wait(cbuf_group_t *group, uint64_t *ready,
+                    int64_t timeout_msec);
+
+int cbuf_group_set_adaptive_wait(cbuf_group_t *group, bool enable,
+                                 int64_t park_nsec);
+
+int cbuf_group_get_wait_stats(cbuf_group_t *group, cbuf_wait_stats_t *stats);
+
+/* Producer side hook, called from the cbuf publish path */
+void cbuf_group_notify(cbuf_t *cbuf, uint8_t *old_writep);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,389 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* pthread_setaffinity_np() */
+#endif
+
+#include "cbuf_pipeline.h"
+#include "cbuf_timeout.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+/* How often a stage waiting for input checks whether its input has ended */
+#define EOS_POLL_MSEC 1
+
+INLINE void stat_add(_Atomic(uint64_t) *stat, uint64_t n) {
+  /* Only the stage's own thread writes its counters */
+  atomic_store_explicit(
+      stat, atomic_load_explicit(stat, memory_order_relaxed) + n,
+      memory_order_relaxed);
+}
+
+static void pin_thread(int cpu) {
+#if defined(__linux__)
+  cpu_set_t set;
+
+  if (cpu < 0)
+    return;
+
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  /* Best effort; an unpinned stage still works */
+  (void)pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+  (void)cpu;
+#endif
+}
+
+/* Call the stage's callback and account for it */
+static int stage_call(cbuf_stage_t *stage, const uint8_t *in, size_t len) {
+  int64_t begin = cbuf_time_now_usec();
+  int ret;
+
+  ret = stage->cfg.fn(stage, in, len, stage->cfg.arg);
+
+  stat_add(&stage->busy_usec, (uint64_t)(cbuf_time_now_usec() - begin));
+  stat_add(&stage->calls, 1);
+  stat_add(&stage->bytes_in, len);
+
+  if (ret < 0) {
+    int none = 0;
+    atomic_compare_exchange_strong(&stage->pipeline->error, &none, ret);
+  }
+  return ret;
+}
+
+/* Whether the output of @p stage is no longer wanted */
+static bool stage_cut_off(cbuf_stage_t *stage) {
+  cbuf_stage_t *next = stage + 1;
+
+  return atomic_load_explicit(&stage->pipeline->error, memory_order_relaxed) ||
+         atomic_load_explicit(&next->ended, memory_order_relaxed);
+}
+
+static void run_source(cbuf_stage_t *stage) {
+  cbuf_pipeline_t *pipeline = stage->pipeline;
+
+  while (!atomic_load_explicit(&pipeline->stop, memory_order_relaxed) &&
+         !stage_cut_off(stage)) {
+    if (stage_call(stage, NULL, 0) != 0)
+      break;
+  }
+}
+
+static void run_stage(cbuf_stage_t *stage) {
+  cbuf_stage_t *prev = stage - 1;
+  cbuf_t *in = &stage->in;
+  size_t unit = stage->cfg.unit, nread;
+  bool last = (stage->index == stage->pipeline->nstages - 1);
+  bool ended = false;
+
+  for (;;) {
+    if (!ended && !last && stage_cut_off(stage)) {
+      ended = true;
+      atomic_store_explicit(&stage->ended, true, memory_order_relaxed);
+    }
+
+    if (cbuf_waitfor_readable(in, unit, EOS_POLL_MSEC) <= 0) {
+      /* Once the previous stage is done, whatever it wrote is visible */
+      if (atomic_load_explicit(&prev->done, memory_order_acquire) &&
+          ((size_t)cbuf_get_readable_size(in) < unit))
+        break;
+      continue;
+    }
+
+    nread = (size_t)cbuf_get_readable_size(in);
+    if (ended) {
+      /* Keep draining so that the previous stage never blocks */
+      (void)cbuf_remove(in, nread);
+      continue;
+    }
+
+    /* Sampled once per data call, see `cbuf_pipeline_get_stats()` */
+    stat_add(&stage->occupancy_sum, nread);
+    stat_add(&stage->samples, 1);
+    if (nread > atomic_load_explicit(&stage->occupancy_max,
+                                     memory_order_relaxed))
+      atomic_store_explicit(&stage->occupancy_max, nread,
+                            memory_order_relaxed);
+
+    nread = MIN(nread, stage->cfg.batch);
+    nread -= nread % unit;
+    (void)cbuf_read_blocking(in, stage->scratch, nread, 0, true);
+
+    if (stage_call(stage, stage->scratch, nread) != 0) {
+      ended = true;
+      atomic_store_explicit(&stage->ended, true, memory_order_relaxed);
+    }
+  }
+
+  /* A trailing partial unit can never be handed over; drop it */
+  (void)cbuf_remove(in, (size_t)cbuf_get_readable_size(in));
+
+  /* A stage cut off has nothing to flush to */
+  if (!ended)
+    (void)stage_call(stage, NULL, 0);
+}
+
+static void *stage_main(void *arg) {
+  cbuf_stage_t *stage = (cbuf_stage_t *)arg;
+
+  pin_thread(stage->cfg.cpu);
+
+  if (stage->index == 0)
+    run_source(stage);
+  else
+    run_stage(stage);
+
+  atomic_store_explicit(&stage->end_usec, cbuf_time_now_usec(),
+                        memory_order_relaxed);
+  atomic_store_explicit(&stage->done, true, memory_order_release);
+  return NULL;
+}
+
+/**
+ * @param[in] pipeline The pipeline to initialize.
+ * @return 0 on success, -1 for invalid arguments.
+ *
+ * @brief Initialize an empty pipeline.
+ */
+int cbuf_pipeline_init(cbuf_pipeline_t *pipeline) {
+  if (!pipeline)
+    return -1;
+
+  memset(pipeline, 0, sizeof(*pipeline));
+  atomic_init(&pipeline->stop, false);
+  atomic_init(&pipeline->error, 0);
+
+  return 0;
+}
+
+/**
+ * @param[in] pipeline An initialized pipeline that was not started yet.
+ * @param[in] cfg The stage configuration.
+ * @return The index of the new stage, or -1 if the pipeline is full or for
+ * invalid arguments.
+ *
+ * @brief Append a stage to @p pipeline. The first stage added is the source.
+ *
+ * @note Not thread safe!
+ */
+int cbuf_pipeline_add(cbuf_pipeline_t *pipeline, const cbuf_stage_cfg_t *cfg) {
+  cbuf_stage_t *stage;
+
+  if (!pipeline || !cfg || !cfg->fn || pipeline->nstarted)
+    return -1;
+
+  if (pipeline->nstages == CBUF_PIPELINE_MAX_STAGES)
+    return -1;
+
+  stage = &pipeline->stages[pipeline->nstages];
+  stage->cfg = *cfg;
+  if (!stage->cfg.batch)
+    stage->cfg.batch = CBUF_PIPELINE_BATCH;
+  if (!stage->cfg.unit)
+    stage->cfg.unit = 1;
+  if (!stage->cfg.capacity)
+    stage->cfg.capacity = CBUF_PIPELINE_CAPACITY;
+
+  /* A batch must hold a unit, and a unit must fit in the input cbuf */
+  if ((stage->cfg.unit > stage->cfg.batch) ||
+      (stage->cfg.unit > stage->cfg.capacity - 1) ||
+      (stage->cfg.capacity < CBUF_MIN_CAPACITY))
+    return -1;
+
+  stage->pipeline = pipeline;
+  stage->index = pipeline->nstages;
+
+  return pipeline->nstages++;
+}
+
+/**
+ * @param[in] pipeline An initialized pipeline with at least two stages.
+ * @return 0 on success, -1 on failure.
+ *
+ * @brief Allocate the cbufs linking the stages of @p pipeline and start one
+ * thread per stage. Stages with a `cpu` set are pinned to that core, where
+ * supported.
+ *
+ * On failure, the stages that were already started are stopped and joined.
+ */
+int cbuf_pipeline_start(cbuf_pipeline_t *pipeline) {
+  cbuf_stage_t *stage;
+  unsigned int i;
+
+  if (!pipeline || (pipeline->nstages < 2) || pipeline->nstarted)
+    return -1;
+
+  for (i = 0; i < pipeline->nstages; i++) {
+    stage = &pipeline->stages[i];
+
+    if (i && (cbuf_init(&stage->in, stage->cfg.capacity) != 0))
+      goto err;
+    stage->scratch = i ? malloc(stage->cfg.batch) : NULL;
+    if (i && !stage->scratch) {
+      cbuf_free(&stage->in);
+      goto err;
+    }
+    if (i)
+      pipeline->stages[i - 1].out = &stage->in;
+  }
+
+  pipeline->start_usec = cbuf_time_now_usec();
+
+  /* Start from the last stage so that every reader is up before its writer */
+  for (i = pipeline->nstages; i-- > 0;) {
+    stage = &pipeline->stages[i];
+    if (pthread_create(&stage->thread, NULL, stage_main, stage) != 0) {
+      /* The source is not running yet; end the stream at stage i */
+      atomic_store(&stage->done, true);
+      pipeline->nstarted = pipeline->nstages - 1 - i;
+      (void)cbuf_pipeline_join(pipeline);
+      return -1;
+    }
+  }
+  pipeline->nstarted = pipeline->nstages;
+
+  return 0;
+
+err:
+  while (i-- > 1) {
+    cbuf_free(&pipeline->stages[i].in);
+    free(pipeline->stages[i].scratch);
+    pipeline->stages[i].scratch = NULL;
+  }
+  return -1;
+}
+
+/**
+ * @param[in] pipeline A started pipeline.
+ *
+ * @brief Ask the source stage to end the stream. The data already produced
+ * still flows through the rest of the pipeline; use `cbuf_pipeline_join()`
+ * to wait for it. Thread safe.
+ */
+void cbuf_pipeline_stop(cbuf_pipeline_t *pipeline) {
+  if (pipeline)
+    atomic_store_explicit(&pipeline->stop, true, memory_order_relaxed);
+}
+
+/**
+ * @param[in] pipeline A started pipeline.
+ * @return 0 if every stage ended normally, the first negative value returned
+ * by a stage callback otherwise, or -1 for invalid arguments.
+ *
+ * @brief Wait for the end of the stream to propagate through all the stages
+ * of @p pipeline and join their threads.
+ */
+int cbuf_pipeline_join(cbuf_pipeline_t *pipeline) {
+  unsigned int i;
+
+  if (!pipeline)
+    return -1;
+
+  /* Stages were started last to first */
+  for (i = pipeline->nstages - pipeline->nstarted; i < pipeline->nstages; i++)
+    pthread_join(pipeline->stages[i].thread, NULL);
+  pipeline->nstarted = 0;
+
+  return atomic_load(&pipeline->error);
+}
+
+/**
+ * @param[in] pipeline A pipeline that is not running.
+ *
+ * @brief Free the cbufs of @p pipeline. The stage counters stay readable.
+ */
+void cbuf_pipeline_free(cbuf_pipeline_t *pipeline) {
+  unsigned int i;
+
+  if (!pipeline)
+    return;
+
+  for (i = 1; i < pipeline->nstages; i++) {
+    if (pipeline->stages[i].scratch) {
+      cbuf_free(&pipeline->stages[i].in);
+      free(pipeline->stages[i].scratch);
+      pipeline->stages[i].scratch = NULL;
+    }
+    pipeline->stages[i - 1].out = NULL;
+  }
+}
+
+/**
+ * @param[in] pipeline An initialized pipeline.
+ * @param[in] index The index of the stage.
+ * @param[out] stats The counters of the stage.
+ * @return 0 on success, -1 for invalid arguments.
+ *
+ * @brief Get a snapshot of the counters of a stage. May be called at any time
+ * from any thread; the counters of a running stage are not read atomically as
+ * a whole. Throughput is `bytes_in / elapsed_usec`, the average occupancy of
+ * the stage's input cbuf is `occupancy_sum / samples`. Input discarded after
+ * the stage ended is not sampled.
+ */
+int cbuf_pipeline_get_stats(cbuf_pipeline_t *pipeline, unsigned int index,
+                            cbuf_stage_stats_t *stats) {
+  cbuf_stage_t *stage;
+  int64_t end;
+
+  if (!pipeline || !stats || (index >= pipeline->nstages))
+    return -1;
+
+  stage = &pipeline->stages[index];
+  stats->bytes_in = atomic_load_explicit(&stage->bytes_in,
+                                         memory_order_relaxed);
+  stats->bytes_out = atomic_load_explicit(&stage->bytes_out,
+                                          memory_order_relaxed);
+  stats->calls = atomic_load_explicit(&stage->calls, memory_order_relaxed);
+  stats->busy_usec = atomic_load_explicit(&stage->busy_usec,
+                                          memory_order_relaxed);
+  stats->samples = atomic_load_explicit(&stage->samples, memory_order_relaxed);
+  stats->occupancy_sum = atomic_load_explicit(&stage->occupancy_sum,
+                                              memory_order_relaxed);
+  stats->occupancy_max = atomic_load_explicit(&stage->occupancy_max,
+                                              memory_order_relaxed);
+
+  if (!pipeline->start_usec) {
+    stats->elapsed_usec = 0;
+    return 0;
+  }
+  end = atomic_load_explicit(&stage->end_usec, memory_order_relaxed);
+  if (!end)
+    end = cbuf_time_now_usec();
+  stats->elapsed_usec = (uint64_t)(end - pipeline->start_usec);
+
+  return 0;
+}
+
+/**
+ * @param[in] stage The calling stage, as passed to its callback.
+ * @param[in] buf The data to emit.
+ * @param[in] nbytes The size of @p buf.
+ * @return @p nbytes on success, or -1 for invalid arguments or if @p stage is
+ * the last stage.
+ *
+ * @brief Write @p nbytes bytes to the next stage, waiting for space as long as
+ * needed. Must only be called from the stage's callback.
+ */
+ssize_t cbuf_stage_emit(cbuf_stage_t *stage, const uint8_t *buf,
+                        size_t nbytes) {
+  size_t off = 0, n, max;
+
+  if (!stage || !stage->out || (!buf && nbytes))
+    return -1;
+
+  /* Emits larger than the next cbuf go in pieces */
+  max = cbuf_get_capacity(stage->out);
+  while (off < nbytes) {
+    n = MIN(nbytes - off, max);
+    (void)cbuf_write_blocking(stage->out, buf + off, n, -1);
+    off += n;
+  }
+
+  stat_add(&stage->bytes_out, nbytes);
+  return nbytes;
+}
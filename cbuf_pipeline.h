@@ -0,0 +1,145 @@
+#pragma once
+
+#include "cbuf.h"
+
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Max number of stages in a pipeline */
+#define CBUF_PIPELINE_MAX_STAGES 16U
+/* Default max number of bytes handed to a stage per call */
+#define CBUF_PIPELINE_BATCH 4096U
+/* Default capacity of the cbuf in front of each stage */
+#define CBUF_PIPELINE_CAPACITY (64U << 10)
+
+/* Stage callback return value: end the stream here, see `cbuf_stage_fn` */
+#define CBUF_STAGE_EOS 1
+
+struct cbuf_stage_st;
+
+/**
+ * A stage callback.
+ *
+ * - The first stage (the source) is called with `in = NULL, len = 0` over and
+ * over, and produces data with `cbuf_stage_emit()`.
+ *
+ * - Every other stage is called with the next @p len bytes of its input, a
+ * multiple of its `unit`, and may emit any amount of output. Once its input
+ * has ended and is drained, it is called one last time with `in = NULL,
+ * len = 0` to flush any state.
+ *
+ * Return 0 to carry on, `CBUF_STAGE_EOS` to end the stream at this stage, or
+ * a negative value on error, which also ends the stream and is reported by
+ * `cbuf_pipeline_join()`. The stages upstream then stop as well; input still
+ * arriving at a stage that has ended is discarded, so they never block.
+ */
+typedef int (*cbuf_stage_fn)(struct cbuf_stage_st *stage, const uint8_t *in,
+                             size_t len, void *arg);
+
+/**
+ * @struct cbuf_stage_cfg_t
+ * @brief Stage configuration for `cbuf_pipeline_add()`. Size fields left at 0
+ * get the defaults in parentheses.
+ */
+typedef struct cbuf_stage_cfg_st {
+  cbuf_stage_fn fn;
+  void *arg;       /* passed to `fn` */
+  int cpu;         /* core to pin the stage's thread to, or -1 */
+  size_t batch;    /* max bytes per call (`CBUF_PIPELINE_BATCH`) */
+  size_t unit;     /* input is handed over in multiples of this (1) */
+  size_t capacity; /* capacity of the input cbuf (`CBUF_PIPELINE_CAPACITY`) */
+} cbuf_stage_cfg_t;
+
+/**
+ * @struct cbuf_stage_stats_t
+ * @brief Per-stage counters, see `cbuf_pipeline_get_stats()`.
+ */
+typedef struct cbuf_stage_stats_st {
+  uint64_t bytes_in;      /* bytes handed to the callback */
+  uint64_t bytes_out;     /* bytes emitted */
+  uint64_t calls;         /* callback invocations */
+  uint64_t busy_usec;     /* time spent in the callback */
+  uint64_t elapsed_usec;  /* time since start, until the stage ended */
+  uint64_t samples;       /* calls with input, i.e. all but the final flush */
+  uint64_t occupancy_sum; /* input readable size before each sample, summed */
+  uint64_t occupancy_max; /* max input readable size seen */
+} cbuf_stage_stats_t;
+
+/**
+ * @struct cbuf_stage_t
+ * @brief A pipeline stage; one thread reading from the cbuf in front of it
+ * and writing into the cbuf in front of the next stage.
+ */
+typedef struct cbuf_stage_st {
+  _Alignas(CACHELINE_SIZE) cbuf_stage_cfg_t cfg;
+  struct cbuf_pipeline_st *pipeline;
+  unsigned int index;
+  cbuf_t in;          /* unused by the source */
+  cbuf_t *out;        /* NULL for the last stage */
+  uint8_t *scratch;   /* `cfg.batch` bytes */
+  pthread_t thread;
+  _Atomic(bool) done;  /* nothing more will be written to `out` */
+  _Atomic(bool) ended; /* input is being discarded */
+  /* only written by the stage's thread */
+  _Atomic(uint64_t) bytes_in;
+  _Atomic(uint64_t) bytes_out;
+  _Atomic(uint64_t) calls;
+  _Atomic(uint64_t) busy_usec;
+  _Atomic(uint64_t) samples;
+  _Atomic(uint64_t) occupancy_sum;
+  _Atomic(uint64_t) occupancy_max;
+  _Atomic(int64_t) end_usec;
+} cbuf_stage_t;
+
+/**
+ * @struct cbuf_pipeline_t
+ * @brief A chain of stages, each running on its own thread, linked by SPSC
+ * cbufs.
+ *
+ * Stages are added in order with `cbuf_pipeline_add()`, the first one being
+ * the source. `cbuf_pipeline_start()` allocates the cbufs and starts one
+ * thread per stage; `cbuf_pipeline_join()` waits for the end of the stream to
+ * propagate through all stages.
+ *
+ * - A stage waits for its input with `cbuf_waitfor_readable()` and hands it to
+ * its callback in batches of up to `cfg.batch` bytes, so the per-call
+ * overhead is amortized when the stage is behind.
+ *
+ * - The end of the stream travels down the chain: when a stage ends, the next
+ * stage drains its input and then ends as well. It also travels up: once a
+ * stage ends or a callback fails, the stages before it stop calling their
+ * callbacks, so the source does not keep producing data nobody will use.
+ */
+typedef struct cbuf_pipeline_st {
+  cbuf_stage_t stages[CBUF_PIPELINE_MAX_STAGES];
+  unsigned int nstages;
+  unsigned int nstarted;
+  _Atomic(bool) stop;
+  _Atomic(int) error; /* first negative callback return value */
+  int64_t start_usec;
+} cbuf_pipeline_t;
+
+int cbuf_pipeline_init(cbuf_pipeline_t *pipeline);
+
+int cbuf_pipeline_add(cbuf_pipeline_t *pipeline, const cbuf_stage_cfg_t *cfg);
+
+int cbuf_pipeline_start(cbuf_pipeline_t *pipeline);
+
+void cbuf_pipeline_stop(cbuf_pipeline_t *pipeline);
+
+int cbuf_pipeline_join(cbuf_pipeline_t *pipeline);
+
+void cbuf_pipeline_free(cbuf_pipeline_t *pipeline);
+
+int cbuf_pipeline_get_stats(cbuf_pipeline_t *pipeline, unsigned int index,
+                            cbuf_stage_stats_t *stats);
+
+ssize_t cbuf_stage_emit(cbuf_stage_t *stage, const uint8_t *buf,
+                        size_t nbytes);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,217 @@
+#include "cbuf_pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#define ALIGN_UP(x, a) (((x) + (a) - 1) & ~((size_t)(a) - 1))
+
+INLINE void pool_lock(cbuf_pool_t *pool) {
+  while (atomic_exchange_explicit(&pool->lock, true, memory_order_acquire)) {
+    while (atomic_load_explicit(&pool->lock, memory_order_relaxed))
+      spin_pause();
+  }
+}
+
+INLINE void pool_unlock(cbuf_pool_t *pool) {
+  atomic_store_explicit(&pool->lock, false, memory_order_release);
+}
+
+/* Reserve @p size bytes, with huge pages if asked to and available */
+static void *region_alloc(size_t *size, unsigned int *flags) {
+  void *mem;
+
+#if defined(__linux__)
+  size_t len;
+
+  if (*flags & CBUF_POOL_HUGE_PAGES) {
+#ifdef MAP_HUGETLB
+    len = ALIGN_UP(*size, CBUF_POOL_HUGE_PAGE_SIZE);
+    mem = mmap(NULL, len, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (mem != MAP_FAILED) {
+      *size = len;
+      return mem;
+    }
+#endif
+    /* No reserved huge pages; fall back to regular pages */
+    *flags &= ~CBUF_POOL_HUGE_PAGES;
+  }
+
+  mem = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+             -1, 0);
+  return (mem == MAP_FAILED) ? NULL : mem;
+#else
+  *flags &= ~CBUF_POOL_HUGE_PAGES;
+  *size += CACHELINE_SIZE;
+  mem = malloc(*size);
+  return mem;
+#endif
+}
+
+static void region_free(void *mem, size_t size) {
+#if defined(__linux__)
+  (void)munmap(mem, size);
+#else
+  (void)size;
+  free(mem);
+#endif
+}
+
+/**
+ * @param[in] pool The pool to initialize.
+ * @param[in] capacity The capacity in bytes of every ring in the pool.
+ * @param[in] nrings The number of rings in the pool.
+ * @param[in] flags `CBUF_POOL_HUGE_PAGES` to back the pool with huge pages,
+ * or 0.
+ * @return 0 on success, -1 on failure.
+ *
+ * @brief Reserve one region for @p nrings rings of @p capacity bytes each.
+ *
+ * With `CBUF_POOL_HUGE_PAGES`, the region is mapped from the reserved huge
+ * page pool if possible, and silently falls back to regular pages otherwise;
+ * check `pool->flags` to find out which one was used.
+ *
+ * @note Not thread safe!
+ */
+int cbuf_pool_init(cbuf_pool_t *pool, size_t capacity, size_t nrings,
+                   unsigned int flags) {
+  size_t slot_size, size;
+  void *mem;
+
+  if (!pool || !nrings)
+    return -1;
+
+  if ((capacity < CBUF_MIN_CAPACITY) || (capacity > CBUF_MAX_CAPACITY))
+    return -1;
+
+  slot_size = ALIGN_UP(sizeof(cbuf_t), CACHELINE_SIZE) +
+              ALIGN_UP(capacity, CACHELINE_SIZE);
+  if (nrings > (SIZE_MAX - CBUF_POOL_HUGE_PAGE_SIZE) / slot_size)
+    return -1;
+
+  size = nrings * slot_size;
+  flags &= CBUF_POOL_HUGE_PAGES;
+  mem = region_alloc(&size, &flags);
+  if (!mem)
+    return -1;
+
+  pool->mem = mem;
+  pool->mem_size = size;
+  pool->base = (uint8_t *)ALIGN_UP((uintptr_t)mem, CACHELINE_SIZE);
+  pool->slot_size = slot_size;
+  pool->capacity = capacity;
+  pool->nslots = nrings;
+  pool->nfree = nrings;
+  pool->next = 0;
+  pool->free_list = NULL;
+  pool->flags = flags;
+  atomic_init(&pool->lock, false);
+
+  return 0;
+}
+
+/**
+ * @param[in] pool The pool to free.
+ *
+ * @brief Release the region of @p pool. All the rings taken from @p pool
+ * become invalid, whether or not they were returned.
+ *
+ * @note Not thread safe!
+ */
+void cbuf_pool_free(cbuf_pool_t *pool) {
+  if (!pool || !pool->mem)
+    return;
+
+  region_free(pool->mem, pool->mem_size);
+  memset(pool, 0, sizeof(*pool));
+}
+
+/**
+ * @param[in] pool An initialized pool.
+ * @return An empty ring with a capacity of `pool->capacity` bytes, or NULL if
+ * the pool is exhausted or for invalid arguments.
+ *
+ * @brief Take a ring from @p pool. The ring must be returned with
+ * `cbuf_pool_put()`; `cbuf_free()` on a pooled ring does not return it.
+ */
+cbuf_t *cbuf_pool_get(cbuf_pool_t *pool) {
+  uint8_t *slot = NULL;
+  cbuf_t *cbuf;
+
+  if (!pool || !pool->base)
+    return NULL;
+
+  pool_lock(pool);
+  if (pool->free_list) {
+    slot = (uint8_t *)pool->free_list;
+    pool->free_list = *(void **)slot;
+  } else if (pool->next < pool->nslots) {
+    slot = pool->base + pool->next * pool->slot_size;
+    pool->next++;
+  }
+  if (slot)
+    pool->nfree--;
+  pool_unlock(pool);
+
+  if (!slot)
+    return NULL;
+
+  cbuf = (cbuf_t *)slot;
+  (void)cbuf_make(cbuf, slot + ALIGN_UP(sizeof(cbuf_t), CACHELINE_SIZE),
+                  pool->capacity);
+  cbuf->flags |= CBUF_F_POOL;
+
+  return cbuf;
+}
+
+/**
+ * @param[in] pool The pool @p cbuf was taken from.
+ * @param[in] cbuf A ring returned by `cbuf_pool_get()` on @p pool.
+ * @return 0 on success, -1 for invalid arguments.
+ *
+ * @brief Return @p cbuf to @p pool. Neither the reader nor the writer may use
+ * @p cbuf anymore.
+ */
+int cbuf_pool_put(cbuf_pool_t *pool, cbuf_t *cbuf) {
+  uint8_t *slot = (uint8_t *)cbuf;
+
+  if (!pool || !cbuf || !(cbuf->flags & CBUF_F_POOL))
+    return -1;
+
+  if ((slot < pool->base) ||
+      (slot >= pool->base + pool->nslots * pool->slot_size) ||
+      ((size_t)(slot - pool->base) % pool->slot_size))
+    return -1;
+
+  /* Catch double puts */
+  cbuf->flags &= ~CBUF_F_POOL;
+
+  pool_lock(pool);
+  *(void **)slot = pool->free_list;
+  pool->free_list = slot;
+  pool->nfree++;
+  pool_unlock(pool);
+
+  return 0;
+}
+
+/**
+ * @param[in] pool An initialized pool.
+ * @return The number of rings that can still be taken from @p pool.
+ */
+size_t cbuf_pool_available(cbuf_pool_t *pool) {
+  size_t n;
+
+  if (!pool)
+    return 0;
+
+  pool_lock(pool);
+  n = pool->nfree;
+  pool_unlock(pool);
+
+  return n;
+}
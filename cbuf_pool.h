@@ -0,0 +1,62 @@
+#pragma once
+
+#include "cbuf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* `cbuf_pool_init()` flags */
+#define CBUF_POOL_HUGE_PAGES 0x01U /* back the region with huge pages */
+
+/* Huge page size assumed when rounding up a huge page backed region */
+#ifndef CBUF_POOL_HUGE_PAGE_SIZE
+#define CBUF_POOL_HUGE_PAGE_SIZE (2U << 20)
+#endif
+
+/**
+ * @struct cbuf_pool_t
+ * @brief A slab of equally sized cbufs carved out of one memory region.
+ *
+ * Every slot holds a cache line aligned `cbuf_t` header immediately followed
+ * by its buffer, so a ring and its data share pages and creating or
+ * destroying a ring is a free list operation with no allocation or syscall.
+ *
+ * - The region is reserved once by `cbuf_pool_init()`; slots are only touched
+ * (and so only faulted in) the first time they are handed out.
+ *
+ * - Freed slots are kept on a LIFO free list, linked through their headers,
+ * so the most recently used (and most likely cached) slot is reused first.
+ *
+ * - `cbuf_pool_get()` and `cbuf_pool_put()` may be called from any thread;
+ * they are serialized by a spinlock held only for the list operation. The
+ * rings themselves follow the usual SPSC rules.
+ */
+typedef struct cbuf_pool_st {
+  uint8_t *base;      /* first slot, cache line aligned */
+  void *mem;          /* region as allocated */
+  size_t mem_size;    /* size of `mem` */
+  size_t slot_size;   /* header + buffer, a multiple of the cache line size */
+  size_t capacity;    /* capacity of each ring */
+  size_t nslots;      /* total number of slots */
+  size_t nfree;       /* number of slots not handed out */
+  size_t next;        /* slots from this index on were never handed out */
+  void *free_list;    /* slots returned by `cbuf_pool_put()` */
+  unsigned int flags; /* `CBUF_POOL_HUGE_PAGES` if huge pages are in use */
+  _Atomic(bool) lock;
+} cbuf_pool_t;
+
+int cbuf_pool_init(cbuf_pool_t *pool, size_t capacity, size_t nrings,
+                   unsigned int flags);
+
+void cbuf_pool_free(cbuf_pool_t *pool);
+
+cbuf_t *cbuf_pool_get(cbuf_pool_t *pool);
+
+int cbuf_pool_put(cbuf_pool_t *pool, cbuf_t *cbuf);
+
+size_t cbuf_pool_available(cbuf_pool_t *pool);
+
+#ifdef __cplusplus
+}
+#endif
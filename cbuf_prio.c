@@ -0,0 +1,160 @@
+#include "cbuf_prio.h"
+#include "cbuf_timeout.h"
+#include "cbuf_wait.h"
+
+/* Reader side emptiness check; `readp` is owned by the caller */
+INLINE bool lane_ready(cbuf_t *cbuf) {
+  return atomic_load_explicit(&cbuf->writep, memory_order_acquire) !=
+         atomic_load_explicit(&cbuf->readp, memory_order_relaxed);
+}
+
+/**
+ * @param[in] prio The priority ring to initialize.
+ * @param[in] urgent_capacity The capacity of the urgent lane in bytes.
+ * @param[in] bulk_capacity The capacity of the bulk lane in bytes.
+ * @return 0 on success, -1 for invalid arguments or if an allocation fails.
+ *
+ * @brief Initialize a two-lane priority ring. See `cbuf_init()` for the
+ * capacity bounds of each lane.
+ */
+int cbuf_prio_init(cbuf_prio_t *prio, size_t urgent_capacity,
+                   size_t bulk_capacity) {
+  if (!prio)
+    return -1;
+
+  if (cbuf_init(&prio->urgent, urgent_capacity) != 0)
+    return -1;
+
+  if (cbuf_init(&prio->bulk, bulk_capacity) != 0) {
+    cbuf_free(&prio->urgent);
+    return -1;
+  }
+
+  return 0;
+}
+
+/**
+ * @param[in] prio The priority ring to free.
+ *
+ * @brief Free both lanes.
+ *
+ * @note Not thread safe!
+ */
+void cbuf_prio_free(cbuf_prio_t *prio) {
+  if (!prio)
+    return;
+
+  cbuf_free(&prio->urgent);
+  cbuf_free(&prio->bulk);
+}
+
+/**
+ * @param[in] prio An initialized priority ring.
+ * @param[in] lane The lane.
+ * @return The cbuf backing @p lane, or NULL for invalid arguments.
+ *
+ * @brief Get a lane for direct use with the cbuf API, e.g. for zero-copy
+ * writes with `cbuf_get_write_segs()`.
+ */
+cbuf_t *cbuf_prio_lane(cbuf_prio_t *prio, cbuf_prio_lane_t lane) {
+  if (!prio)
+    return NULL;
+
+  switch (lane) {
+  case CBUF_PRIO_URGENT:
+    return &prio->urgent;
+  case CBUF_PRIO_BULK:
+    return &prio->bulk;
+  default:
+    return NULL;
+  }
+}
+
+/**
+ * @param[in] prio An initialized priority ring.
+ * @param[in] lane The lane to write to.
+ * @param[in] buf The data to write.
+ * @param[in] nbytes The number of bytes to write.
+ * @param[in] timeout_msec The wait timeout (in milliseconds).
+ * @return @p nbytes on success, 0 on timeout, -1 for invalid arguments.
+ *
+ * @brief Write @p buf to @p lane, all or nothing; see
+ * `cbuf_write_blocking()`. Only the producer of @p lane may call this.
+ *
+ * The following values of @p timeout_msec are special:
+ *
+ * - `0`: return immediately
+ *
+ * - `-1`: wait indefinitely
+ */
+ssize_t cbuf_prio_write(cbuf_prio_t *prio, cbuf_prio_lane_t lane,
+                        const uint8_t *buf, size_t nbytes,
+                        int64_t timeout_msec) {
+  cbuf_t *cbuf = cbuf_prio_lane(prio, lane);
+
+  if (!cbuf)
+    return -1;
+
+  return cbuf_write_blocking(cbuf, buf, nbytes, timeout_msec);
+}
+
+/**
+ * @param[in] prio An initialized priority ring.
+ * @param[out] buf The buffer to read into.
+ * @param[in] nbytes The max number of bytes to read.
+ * @param[in] timeout_msec The wait timeout (in milliseconds).
+ * @param[out] lane The lane the data was read from; may be NULL.
+ * @return The number of bytes read, 0 on timeout, -1 for invalid arguments.
+ *
+ * @brief Read at most @p nbytes from a single lane, waiting for at most
+ * @p timeout_msec ms for data in either lane. The urgent lane is always
+ * drained first; bulk data is only returned while the urgent lane is empty.
+ * The wait is adaptive if adaptive waiting is enabled on the bulk lane, see
+ * `cbuf_set_adaptive_wait()`.
+ *
+ * The following values of @p timeout_msec are special:
+ *
+ * - `0`: return immediately
+ *
+ * - `-1`: wait indefinitely
+ */
+ssize_t cbuf_prio_read(cbuf_prio_t *prio, uint8_t *buf, size_t nbytes,
+                       int64_t timeout_msec, cbuf_prio_lane_t *lane) {
+  cbuf_timeout_t timeout;
+  cbuf_t *cbuf;
+  cbuf_prio_lane_t from;
+  cbuf_waiter_t waiter;
+
+  if (!prio || !buf || !nbytes)
+    return -1;
+
+  cbuf_waiter_begin(&waiter, &prio->bulk, CBUF_READER);
+  cbuf_timeout_begin(&timeout, timeout_msec);
+  for (;;) {
+    if (lane_ready(&prio->urgent)) {
+      cbuf = &prio->urgent;
+      from = CBUF_PRIO_URGENT;
+      break;
+    }
+    if (lane_ready(&prio->bulk)) {
+      cbuf = &prio->bulk;
+      from = CBUF_PRIO_BULK;
+      break;
+    }
+
+    if (cbuf_timeout_expired(&timeout)) {
+      cbuf_waiter_end(&waiter);
+      return 0;
+    }
+
+    cbuf_waiter_wait(&waiter);
+  }
+  cbuf_waiter_end(&waiter);
+
+  if (lane)
+    *lane = from;
+
+  /* The lanes differ in size; never ask for more than the lane can hold */
+  nbytes = MIN(nbytes, cbuf_get_capacity(cbuf));
+  return cbuf_read_blocking(cbuf, buf, nbytes, 0, false);
+}
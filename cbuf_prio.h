@@ -0,0 +1,58 @@
+#pragma once
+
+#include "cbuf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @enum cbuf_prio_lane_t
+ * @brief The lanes of a `cbuf_prio_t`.
+ */
+typedef enum cbuf_prio_lane_e {
+  CBUF_PRIO_BULK = 0, /* bulk data */
+  CBUF_PRIO_URGENT,   /* control messages, always read first */
+} cbuf_prio_lane_t;
+
+/**
+ * @struct cbuf_prio_t
+ * @brief A two-lane priority ring: a small urgent lane in front of a bulk
+ * lane, behind one consumer.
+ *
+ * Control messages (cancel, heartbeat, ...) written to the urgent lane never
+ * queue behind bulk data, so a full bulk lane does not delay them.
+ *
+ * - Each lane is an ordinary SPSC `cbuf_t`. The lanes may be written by one
+ * producer thread or by one producer each, and are read by one consumer.
+ *
+ * - `cbuf_prio_read()` drains the urgent lane before touching the bulk lane.
+ * Checking the urgent lane costs a single acquire load of its write pointer,
+ * since the read pointer is owned by the consumer.
+ *
+ * - Lanes are byte streams like any cbuf; ordering only holds within a lane.
+ * Urgent writes are all or nothing, so fixed size control messages read with
+ * a buffer of that size are never split.
+ */
+typedef struct cbuf_prio_st {
+  _Alignas(CACHELINE_SIZE) cbuf_t urgent;
+  _Alignas(CACHELINE_SIZE) cbuf_t bulk;
+} cbuf_prio_t;
+
+int cbuf_prio_init(cbuf_prio_t *prio, size_t urgent_capacity,
+                   size_t bulk_capacity);
+
+void cbuf_prio_free(cbuf_prio_t *prio);
+
+cbuf_t *cbuf_prio_lane(cbuf_prio_t *prio, cbuf_prio_lane_t lane);
+
+ssize_t cbuf_prio_write(cbuf_prio_t *prio, cbuf_prio_lane_t lane,
+                        const uint8_t *buf, size_t nbytes,
+                        int64_t timeout_msec);
+
+ssize_t cbuf_prio_read(cbuf_prio_t *prio, uint8_t *buf, size_t nbytes,
+                       int64_t timeout_msec, cbuf_prio_lane_t *lane);
+
+#ifdef __cplusplus
+}
+#endif
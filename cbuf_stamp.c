@@ -0,0 +1,195 @@
+#include "cbuf_stamp.h"
+#include "cbuf_timeout.h"
+#include "cbuf_wait.h"
+
+#include <string.h>
+
+INLINE uint64_t stamp_now(void) { return (uint64_t)cbuf_time_now_nsec(); }
+
+/**
+ * @param[in] cbuf An initialized cbuf instance. See `cbuf_init()` and
+ * `cbuf_make()`.
+ * @param[in] buf The record to write.
+ * @param[in] nbytes The size of the record.
+ * @param[in] timeout_msec The wait timeout (in milliseconds).
+ * @return @p nbytes on success, 0 on timeout, -1 for invalid arguments or if
+ * the record can never fit in @p cbuf.
+ *
+ * @brief Write @p buf as one timestamped record, all or nothing, waiting for
+ * at most @p timeout_msec ms for space. The timestamp is taken right before
+ * the record is published, so the time spent waiting for space is not
+ * counted as residency.
+ *
+ * The following values of @p timeout_msec are special:
+ *
+ * - `0`: return immediately
+ *
+ * - `-1`: wait indefinitely
+ */
+ssize_t cbuf_stamp_write(cbuf_t *cbuf, const uint8_t *buf, size_t nbytes,
+                         int64_t timeout_msec) {
+  cbuf_stamp_hdr_t hdr;
+  cbuf_segs_t segs, hsegs;
+  size_t need = sizeof(hdr) + nbytes, len;
+  int ret;
+
+  if (!cbuf || !buf || (nbytes > UINT32_MAX))
+    return -1;
+
+  ret = cbuf_waitfor_writable(cbuf, need, timeout_msec);
+  if (ret <= 0)
+    return ret;
+
+  (void)cbuf_get_write_segs(cbuf, &segs);
+  hsegs = segs;
+
+  /* Skip past the header, which is filled in last */
+  if (segs.len[0] >= sizeof(hdr)) {
+    segs.ptr[0] += sizeof(hdr);
+    segs.len[0] -= sizeof(hdr);
+  } else {
+    segs.ptr[1] += sizeof(hdr) - segs.len[0];
+    segs.len[1] -= sizeof(hdr) - segs.len[0];
+    segs.len[0] = 0;
+  }
+  len = MIN(segs.len[0], nbytes);
+  memcpy(segs.ptr[0], buf, len);
+  if (nbytes - len)
+    memcpy(segs.ptr[1], buf + len, nbytes - len);
+
+  hdr.ts_nsec = stamp_now();
+  hdr.len = (uint32_t)nbytes;
+  hdr.reserved = 0;
+  len = MIN(hsegs.len[0], sizeof(hdr));
+  memcpy(hsegs.ptr[0], &hdr, len);
+  if (sizeof(hdr) - len)
+    memcpy(hsegs.ptr[1], (uint8_t *)&hdr + len, sizeof(hdr) - len);
+
+  (void)cbuf_commit(cbuf, need);
+  return nbytes;
+}
+
+/**
+ * @param[in] reader The reader state to initialize.
+ * @param[in] ttl_nsec Skip records older than this, or 0 to return every
+ * record.
+ * @return 0 on success, -1 for invalid arguments.
+ */
+int cbuf_stamp_reader_init(cbuf_stamp_reader_t *reader, uint64_t ttl_nsec) {
+  if (!reader)
+    return -1;
+
+  memset(reader, 0, sizeof(*reader));
+  reader->ttl_nsec = ttl_nsec;
+
+  return 0;
+}
+
+/**
+ * @param[in] cbuf An initialized cbuf instance holding records written with
+ * `cbuf_stamp_write()`.
+ * @param[in] reader The reader state.
+ * @param[out] buf The buffer to read the record into.
+ * @param[in] nbytes The size of @p buf.
+ * @return The size of the record read, 0 on timeout, or -1 for invalid
+ * arguments or if the next record does not fit in @p buf (it is left in
+ * @p cbuf).
+ *
+ * @brief Read the next record that is not older than the reader's TTL,
+ * waiting for at most @p timeout_msec ms for one to arrive. All the stale
+ * records in front of it are consumed together, without being copied.
+ *
+ * The following values of @p timeout_msec are special:
+ *
+ * - `0`: return immediately
+ *
+ * - `-1`: wait indefinitely
+ */
+ssize_t cbuf_stamp_read(cbuf_t *cbuf, cbuf_stamp_reader_t *reader,
+                        uint8_t *buf, size_t nbytes, int64_t timeout_msec) {
+  cbuf_stamp_hdr_t hdr;
+  cbuf_timeout_t timeout;
+  uint64_t now, age;
+  size_t skip;
+  cbuf_waiter_t waiter;
+  bool found = false;
+
+  if (!cbuf || !reader || !buf)
+    return -1;
+
+  cbuf_waiter_begin(&waiter, cbuf, CBUF_READER);
+  cbuf_timeout_begin(&timeout, timeout_msec);
+  for (;;) {
+    /* A header is only visible once its whole record is */
+    now = stamp_now();
+    skip = 0;
+    while (cbuf_peek_at(cbuf, skip, (uint8_t *)&hdr, sizeof(hdr)) ==
+           sizeof(hdr)) {
+      age = (now > hdr.ts_nsec) ? now - hdr.ts_nsec : 0;
+      if (!reader->ttl_nsec || (age <= reader->ttl_nsec)) {
+        found = true;
+        break;
+      }
+      skip += sizeof(hdr) + hdr.len;
+      reader->dropped_records++;
+      reader->dropped_bytes += hdr.len;
+    }
+    if (skip)
+      (void)cbuf_remove(cbuf, skip);
+
+    if (found)
+      break;
+
+    if (cbuf_timeout_expired(&timeout)) {
+      cbuf_waiter_end(&waiter);
+      return 0;
+    }
+
+    cbuf_waiter_wait(&waiter);
+  }
+  cbuf_waiter_end(&waiter);
+
+  if (hdr.len > nbytes)
+    return -1;
+
+  (void)cbuf_peek_at(cbuf, sizeof(hdr), buf, hdr.len);
+  (void)cbuf_remove(cbuf, sizeof(hdr) + hdr.len);
+
+  reader->records++;
+  reader->hist[63 - __builtin_clzll(age | 1)]++;
+
+  return hdr.len;
+}
+
+/**
+ * @param[in] reader The reader state.
+ * @param[in] pct The percentile, in [0, 100].
+ * @return An upper bound in ns of the residency of @p pct percent of the
+ * records returned so far (the top of the histogram bucket it falls in), or
+ * 0 if no record was returned yet.
+ */
+uint64_t cbuf_stamp_percentile(const cbuf_stamp_reader_t *reader,
+                               double pct) {
+  uint64_t rank, seen = 0;
+  double exact;
+  unsigned int i;
+
+  if (!reader || !reader->records || (pct < 0) || (pct > 100))
+    return 0;
+
+  /* Nearest rank: round up, so p51 of two records is the second one */
+  exact = (pct / 100.0) * (double)reader->records;
+  rank = (uint64_t)exact;
+  if ((double)rank < exact)
+    rank++;
+  if (rank < 1)
+    rank = 1;
+
+  for (i = 0; i < CBUF_STAMP_BUCKETS; i++) {
+    seen += reader->hist[i];
+    if (seen >= rank)
+      break;
+  }
+
+  return (i >= CBUF_STAMP_BUCKETS - 1) ? UINT64_MAX : (2ULL << i) - 1;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "cbuf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Number of residency histogram buckets; bucket i counts [2^i, 2^(i+1)) ns */
+#define CBUF_STAMP_BUCKETS 64U
+
+/**
+ * @struct cbuf_stamp_hdr_t
+ * @brief Header in front of every timestamped record in the cbuf.
+ */
+typedef struct cbuf_stamp_hdr_st {
+  uint64_t ts_nsec; /* CLOCK_MONOTONIC when the record was published */
+  uint32_t len;     /* payload length */
+  uint32_t reserved;
+} cbuf_stamp_hdr_t;
+
+/**
+ * @struct cbuf_stamp_reader_t
+ * @brief Consumer side state of a timestamped record stream.
+ *
+ * Records are written with `cbuf_stamp_write()`, which stamps each one right
+ * before publishing it, and read with `cbuf_stamp_read()`, which records how
+ * long each one sat in the cbuf (its residency) in a log2 histogram. With a
+ * TTL set, records that are already older than the TTL when the reader gets
+ * to them are skipped in bulk, with a single `cbuf_remove()`, so a lagging
+ * reader catches up instead of processing stale data.
+ *
+ * Only the reader may use this; read the counters from the reader's thread or
+ * after it has stopped.
+ */
+typedef struct cbuf_stamp_reader_st {
+  uint64_t ttl_nsec;                 /* 0 to never drop */
+  uint64_t records;                  /* records returned */
+  uint64_t dropped_records;          /* records skipped for their age */
+  uint64_t dropped_bytes;            /* payload bytes skipped */
+  uint64_t hist[CBUF_STAMP_BUCKETS]; /* residency of the returned records */
+} cbuf_stamp_reader_t;
+
+ssize_t cbuf_stamp_write(cbuf_t *cbuf, const uint8_t *buf, size_t nbytes,
+                         int64_t timeout_msec);
+
+int cbuf_stamp_reader_init(cbuf_stamp_reader_t *reader, uint64_t ttl_nsec);
+
+ssize_t cbuf_stamp_read(cbuf_t *cbuf, cbuf_stamp_reader_t *reader,
+                        uint8_t *buf, size_t nbytes, int64_t timeout_msec);
+
+uint64_t cbuf_stamp_percentile(const cbuf_stamp_reader_t *reader,
+                               double pct);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,444 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* O_DIRECT */
+#endif
+
+#include "cbuf_tee.h"
+#include "cbuf_timeout.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+
+#define BLOCK_PAYLOAD (CBUF_TEE_BLOCK_SIZE - sizeof(cbuf_tee_block_hdr_t))
+/* O_DIRECT buffer and size alignment */
+#define DIRECT_ALIGN 4096U
+
+INLINE uint64_t monotonic_nsec(void) {
+  struct timespec ts;
+
+  (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+INLINE void stat_add(_Atomic(uint64_t) *stat, uint64_t n) {
+  /* Each counter has a single writer */
+  atomic_store_explicit(
+      stat, atomic_load_explicit(stat, memory_order_relaxed) + n,
+      memory_order_relaxed);
+}
+
+/* Copy @p n bytes from @p src into the segments @p segs at offset @p off */
+static size_t segs_put(const cbuf_segs_t *segs, size_t off, const void *src,
+                       size_t n) {
+  const uint8_t *p = (const uint8_t *)src;
+  size_t len;
+
+  if (off < segs->len[0]) {
+    len = MIN(segs->len[0] - off, n);
+    memcpy(segs->ptr[0] + off, p, len);
+    p += len;
+    n -= len;
+    off += len;
+  }
+  if (n)
+    memcpy(segs->ptr[1] + (off - segs->len[0]), p, n);
+
+  return off + n;
+}
+
+/**
+ * Runs on the consumer's thread, right before it publishes its read pointer,
+ * while the consumed bytes between @p from and @p to are still intact.
+ */
+void cbuf_tee_capture(cbuf_t *cbuf, const uint8_t *from, const uint8_t *to) {
+  cbuf_tee_t *tee = cbuf->tee;
+  cbuf_tee_chunk_hdr_t hdr;
+  cbuf_segs_t segs;
+  const uint8_t *end = cbuf->buf + cbuf->capacity;
+  size_t n, left, part, len, need, off = 0;
+
+  n = (to >= from) ? (size_t)(to - from)
+                   : (size_t)(end - from) + (size_t)(to - cbuf->buf);
+
+  /* A chunk holds at most UINT32_MAX bytes; larger reads take several */
+  need = n + sizeof(hdr) * (n ? (n - 1) / UINT32_MAX + 1 : 1);
+
+  /* Never wait for the recorder; drop the data instead */
+  if ((size_t)cbuf_get_write_segs(&tee->staging, &segs) < need) {
+    stat_add(&tee->dropped_bytes, n);
+    return;
+  }
+
+  hdr.ts_nsec = monotonic_nsec();
+  hdr.reserved = 0;
+
+  left = n;
+  do {
+    part = MIN(left, (size_t)UINT32_MAX);
+    hdr.len = (uint32_t)part;
+    off = segs_put(&segs, off, &hdr, sizeof(hdr));
+
+    len = MIN(part, (size_t)(end - from));
+    off = segs_put(&segs, off, from, len);
+    from += len;
+    if (from == end)
+      from = cbuf->buf;
+    if (part > len) {
+      off = segs_put(&segs, off, from, part - len);
+      from += part - len;
+    }
+    left -= part;
+  } while (left);
+  (void)cbuf_commit(&tee->staging, off);
+
+  stat_add(&tee->bytes, n);
+  stat_add(&tee->chunks, 1);
+}
+
+/* Write out the current block, zero padded, and start a new one */
+static void write_block(cbuf_tee_t *tee, size_t used) {
+  cbuf_tee_block_hdr_t *hdr = (cbuf_tee_block_hdr_t *)tee->block;
+  size_t off = 0;
+  ssize_t ret;
+
+  hdr->magic = CBUF_TEE_MAGIC;
+  hdr->used = (uint32_t)used;
+  memset(tee->block + sizeof(*hdr) + used, 0, BLOCK_PAYLOAD - used);
+
+  while (off < CBUF_TEE_BLOCK_SIZE) {
+    ret = write(tee->fd, tee->block + off, CBUF_TEE_BLOCK_SIZE - off);
+    if (ret > 0) {
+      off += ret;
+    } else if ((ret < 0) && (errno == EINTR)) {
+      continue;
+    } else if ((ret < 0) && (errno == EINVAL) &&
+               atomic_load_explicit(&tee->direct, memory_order_relaxed)) {
+      /* Opened, but the file system refuses direct I/O after all */
+      (void)fcntl(tee->fd, F_SETFL, fcntl(tee->fd, F_GETFL) & ~O_DIRECT);
+      atomic_store_explicit(&tee->direct, false, memory_order_relaxed);
+    } else {
+      atomic_store_explicit(&tee->error, ret < 0 ? errno : EIO,
+                            memory_order_relaxed);
+      return;
+    }
+  }
+
+  stat_add(&tee->blocks, 1);
+}
+
+static void *recorder_main(void *arg) {
+  cbuf_tee_t *tee = (cbuf_tee_t *)arg;
+  cbuf_t *staging = &tee->staging;
+  uint8_t *payload = tee->block + sizeof(cbuf_tee_block_hdr_t);
+  cbuf_tee_chunk_hdr_t hdr;
+  size_t used = 0, part;
+  int64_t begin = 0;
+
+  for (;;) {
+    if (cbuf_waitfor_readable(staging, sizeof(hdr), 10) > 0) {
+      (void)cbuf_read_blocking(staging, (uint8_t *)&hdr, sizeof(hdr), 0,
+                               true);
+      if (!used)
+        begin = cbuf_time_now();
+
+      /* Chunks never straddle blocks; split the data instead */
+      while (hdr.len) {
+        if (BLOCK_PAYLOAD - used <= sizeof(hdr)) {
+          write_block(tee, used);
+          used = 0;
+          begin = cbuf_time_now();
+        }
+        part = MIN(hdr.len, BLOCK_PAYLOAD - used - sizeof(hdr));
+
+        cbuf_tee_chunk_hdr_t chunk = {hdr.ts_nsec, (uint32_t)part, 0};
+        memcpy(payload + used, &chunk, sizeof(chunk));
+        used += sizeof(chunk);
+        (void)cbuf_read_blocking(staging, payload + used, part, 0, true);
+        used += part;
+        hdr.len -= part;
+      }
+    } else if (atomic_load_explicit(&tee->stop, memory_order_acquire)) {
+      break; /* detached and drained */
+    }
+
+    if (used && (cbuf_time_now() - begin >= CBUF_TEE_FLUSH_MSEC)) {
+      write_block(tee, used);
+      used = 0;
+    }
+  }
+
+  if (used)
+    write_block(tee, used);
+  return NULL;
+}
+
+/**
+ * @param[in] tee The recorder to start.
+ * @param[in] cbuf An initialized cbuf instance. See `cbuf_init()` and
+ * `cbuf_make()`.
+ * @param[in] path The recording file; created or truncated.
+ * @param[in] staging The capacity of the staging cbuf, or 0 for
+ * `CBUF_TEE_STAGING`. Bursts that do not fit are dropped from the recording.
+ * @return 0 on success, -1 on failure.
+ *
+ * @brief Start recording everything the reader consumes from @p cbuf, through
+ * any of the read functions, to @p path. See `cbuf_tee_t` and `cbuf_replay()`.
+ *
+ * @note Not thread safe! Start the recorder while the reader is not running.
+ */
+int cbuf_tee_start(cbuf_tee_t *tee, cbuf_t *cbuf, const char *path,
+                   size_t staging) {
+  void *block;
+  bool direct = true;
+  int fd;
+
+  if (!tee || !cbuf || !path || cbuf->tee)
+    return -1;
+
+  if (!staging)
+    staging = CBUF_TEE_STAGING;
+
+  fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_DIRECT, 0644);
+  if ((fd < 0) && (errno == EINVAL)) {
+    /* e.g. tmpfs */
+    direct = false;
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  }
+  if (fd < 0)
+    return -1;
+
+  if (posix_memalign(&block, DIRECT_ALIGN, CBUF_TEE_BLOCK_SIZE) != 0)
+    goto err_close;
+
+  if (cbuf_init(&tee->staging, staging) != 0)
+    goto err_block;
+
+  tee->cbuf = cbuf;
+  tee->block = (uint8_t *)block;
+  tee->fd = fd;
+  atomic_init(&tee->stop, false);
+  atomic_init(&tee->bytes, 0);
+  atomic_init(&tee->chunks, 0);
+  atomic_init(&tee->dropped_bytes, 0);
+  atomic_init(&tee->blocks, 0);
+  atomic_init(&tee->direct, direct);
+  atomic_init(&tee->error, 0);
+
+  if (pthread_create(&tee->thread, NULL, recorder_main, tee) != 0)
+    goto err_staging;
+
+  cbuf->tee = tee;
+  cbuf->flags |= CBUF_F_TEE;
+  return 0;
+
+err_staging:
+  cbuf_free(&tee->staging);
+err_block:
+  free(block);
+err_close:
+  (void)close(fd);
+  return -1;
+}
+
+/**
+ * @param[in] tee A started recorder.
+ * @return 0 on success, -1 if writing the recording failed at some point.
+ *
+ * @brief Detach @p tee from its cbuf, write out everything captured so far
+ * and close the file.
+ *
+ * @note Not thread safe! Stop the recorder while the reader is not running.
+ */
+int cbuf_tee_stop(cbuf_tee_t *tee) {
+  int ret;
+
+  if (!tee || !tee->cbuf)
+    return -1;
+
+  tee->cbuf->flags &= ~CBUF_F_TEE;
+  tee->cbuf->tee = NULL;
+  tee->cbuf = NULL;
+
+  atomic_store_explicit(&tee->stop, true, memory_order_release);
+  pthread_join(tee->thread, NULL);
+
+  ret = atomic_load(&tee->error) ? -1 : 0;
+  if (fsync(tee->fd) != 0)
+    ret = -1;
+  if (close(tee->fd) != 0)
+    ret = -1;
+  free(tee->block);
+  cbuf_free(&tee->staging);
+
+  return ret;
+}
+
+/**
+ * @param[in] tee A started or stopped recorder.
+ * @param[out] stats The recorder counters.
+ * @return 0 on success, -1 for invalid arguments.
+ */
+int cbuf_tee_get_stats(cbuf_tee_t *tee, cbuf_tee_stats_t *stats) {
+  if (!tee || !stats)
+    return -1;
+
+  stats->bytes = atomic_load_explicit(&tee->bytes, memory_order_relaxed);
+  stats->chunks = atomic_load_explicit(&tee->chunks, memory_order_relaxed);
+  stats->dropped_bytes =
+      atomic_load_explicit(&tee->dropped_bytes, memory_order_relaxed);
+  stats->blocks = atomic_load_explicit(&tee->blocks, memory_order_relaxed);
+  stats->direct = atomic_load_explicit(&tee->direct, memory_order_relaxed);
+
+  return 0;
+}
+
+/* Sleep until @p deadline (CLOCK_MONOTONIC, ns) */
+static void sleep_until(uint64_t deadline) {
+  struct timespec ts = {(time_t)(deadline / 1000000000ULL),
+                        (long)(deadline % 1000000000ULL)};
+
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+    ;
+}
+
+/**
+ * @param[in] cbuf An initialized cbuf instance; the caller must be its writer.
+ * @param[in] path A recording made with `cbuf_tee_start()`.
+ * @param[in] speed Replay speed relative to the recording (1.0 for the
+ * original rate), or 0 to replay as fast as @p cbuf is drained.
+ * @return The number of bytes replayed, or -1 if @p path cannot be read or is
+ * not a valid recording.
+ *
+ * @brief Write the data recorded in @p path into @p cbuf, one write per
+ * recorded chunk, spaced out by the recorded timestamps scaled by @p speed.
+ * Waits for free space in @p cbuf as long as needed.
+ *
+ * A chunk is usually one original read. A read is replayed as several writes
+ * (with the same timestamp) if it was recorded as several chunks, because it
+ * was larger than `UINT32_MAX` bytes or crossed a block of the recording, or
+ * if it is larger than the capacity of @p cbuf.
+ */
+ssize_t cbuf_replay(cbuf_t *cbuf, const char *path, double speed) {
+  cbuf_tee_block_hdr_t bhdr;
+  cbuf_tee_chunk_hdr_t chdr;
+  uint64_t ts0 = 0, t0 = 0;
+  uint8_t *block;
+  size_t off, len, n;
+  ssize_t total = 0, ret;
+  bool first = true;
+  int fd;
+
+  if (!cbuf || !path || (speed < 0))
+    return -1;
+
+  fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+
+  block = (uint8_t *)malloc(CBUF_TEE_BLOCK_SIZE);
+  if (!block) {
+    (void)close(fd);
+    return -1;
+  }
+
+  for (;;) {
+    off = 0;
+    while (off < CBUF_TEE_BLOCK_SIZE) {
+      ret = read(fd, block + off, CBUF_TEE_BLOCK_SIZE - off);
+      if ((ret < 0) && (errno == EINTR))
+        continue;
+      if (ret <= 0)
+        break;
+      off += ret;
+    }
+    if (!off)
+      break; /* end of file */
+    if (off < CBUF_TEE_BLOCK_SIZE)
+      goto err; /* truncated */
+
+    memcpy(&bhdr, block, sizeof(bhdr));
+    if ((bhdr.magic != CBUF_TEE_MAGIC) || (bhdr.used > BLOCK_PAYLOAD))
+      goto err;
+
+    for (off = sizeof(bhdr); off < sizeof(bhdr) + bhdr.used;
+         off += sizeof(chdr) + chdr.len) {
+      if (sizeof(bhdr) + bhdr.used - off < sizeof(chdr))
+        goto err;
+      memcpy(&chdr, block + off, sizeof(chdr));
+      if (chdr.len > sizeof(bhdr) + bhdr.used - off - sizeof(chdr))
+        goto err;
+
+      if (speed > 0) {
+        if (first) {
+          ts0 = chdr.ts_nsec;
+          t0 = monotonic_nsec();
+          first = false;
+        } else if (chdr.ts_nsec > ts0) {
+          sleep_until(t0 + (uint64_t)((double)(chdr.ts_nsec - ts0) / speed));
+        }
+      }
+
+      /* Reads larger than cbuf go in pieces */
+      for (len = 0; len < chdr.len; len += n) {
+        n = MIN(chdr.len - len, cbuf_get_capacity(cbuf));
+        (void)cbuf_write_blocking(cbuf, block + off + sizeof(chdr) + len, n,
+                                  -1);
+      }
+      total += chdr.len;
+    }
+  }
+
+  free(block);
+  (void)close(fd);
+  return total;
+
+err:
+  free(block);
+  (void)close(fd);
+  return -1;
+}
+
+#else /* !__linux__ */
+
+void cbuf_tee_capture(cbuf_t *cbuf, const uint8_t *from, const uint8_t *to) {
+  (void)cbuf;
+  (void)from;
+  (void)to;
+}
+
+int cbuf_tee_start(cbuf_tee_t *tee, cbuf_t *cbuf, const char *path,
+                   size_t staging) {
+  (void)tee;
+  (void)cbuf;
+  (void)path;
+  (void)staging;
+  return -1;
+}
+
+int cbuf_tee_stop(cbuf_tee_t *tee) {
+  (void)tee;
+  return -1;
+}
+
+int cbuf_tee_get_stats(cbuf_tee_t *tee, cbuf_tee_stats_t *stats) {
+  (void)tee;
+  (void)stats;
+  return -1;
+}
+
+ssize_t cbuf_replay(cbuf_t *cbuf, const char *path, double speed) {
+  (void)cbuf;
+  (void)path;
+  (void)speed;
+  return -1;
+}
+
+#endif /* __linux__ */
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "cbuf.h"
+
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CBUF_TEE_MAGIC 0x45544243U /* "CBTE" */
+/* Recordings are written in blocks of this size, aligned for O_DIRECT */
+#define CBUF_TEE_BLOCK_SIZE (64U << 10)
+/* Default capacity of the staging cbuf between the consumer and the disk */
+#define CBUF_TEE_STAGING (4U << 20)
+/* A partially filled block is written out after at most this long */
+#define CBUF_TEE_FLUSH_MSEC 100
+
+/**
+ * On-disk layout of a recording: a sequence of `CBUF_TEE_BLOCK_SIZE` blocks,
+ * each starting with a `cbuf_tee_block_hdr_t` followed by `used` bytes of
+ * chunks (zero padded to the end of the block). Each chunk is a
+ * `cbuf_tee_chunk_hdr_t` followed by `len` bytes of data. Timestamps are only
+ * meaningful relative to each other, so that replay pacing is not thrown off
+ * by wall clock adjustments.
+ */
+typedef struct cbuf_tee_block_hdr_st {
+  uint32_t magic;
+  uint32_t used;
+} cbuf_tee_block_hdr_t;
+
+typedef struct cbuf_tee_chunk_hdr_st {
+  uint64_t ts_nsec; /* CLOCK_MONOTONIC when the data was consumed */
+  uint32_t len;     /* larger reads are split into several chunks */
+  uint32_t reserved;
+} cbuf_tee_chunk_hdr_t;
+
+/**
+ * @struct cbuf_tee_stats_t
+ * @brief Recorder counters, see `cbuf_tee_get_stats()`.
+ */
+typedef struct cbuf_tee_stats_st {
+  uint64_t bytes;         /* bytes captured */
+  uint64_t chunks;        /* reads captured */
+  uint64_t dropped_bytes; /* bytes lost to a full staging cbuf */
+  uint64_t blocks;        /* blocks written to the file */
+  bool direct;            /* the file is written with O_DIRECT */
+} cbuf_tee_stats_t;
+
+/**
+ * @struct cbuf_tee_t
+ * @brief Records everything consumed from a cbuf to a file.
+ *
+ * Every time the consumer publishes its read pointer, the consumed bytes are
+ * copied, with a timestamp, into a staging cbuf. This copy never waits: if the
+ * staging cbuf is full, the data is dropped from the recording and counted in
+ * `dropped_bytes`. A background thread drains the staging cbuf into aligned
+ * blocks and writes them to the file, with O_DIRECT where the file system
+ * supports it, so the consumer never waits on the disk.
+ */
+typedef struct cbuf_tee_st {
+  cbuf_t *cbuf;
+  cbuf_t staging;
+  uint8_t *block;
+  int fd;
+  pthread_t thread;
+  _Atomic(bool) stop;
+  /* written by the consumer */
+  _Atomic(uint64_t) bytes;
+  _Atomic(uint64_t) chunks;
+  _Atomic(uint64_t) dropped_bytes;
+  /* written by the recorder thread */
+  _Atomic(uint64_t) blocks;
+  _Atomic(bool) direct;
+  _Atomic(int) error;
+} cbuf_tee_t;
+
+int cbuf_tee_start(cbuf_tee_t *tee, cbuf_t *cbuf, const char *path,
+                   size_t staging);
+
+int cbuf_tee_stop(cbuf_tee_t *tee);
+
+int cbuf_tee_get_stats(cbuf_tee_t *tee, cbuf_tee_stats_t *stats);
+
+ssize_t cbuf_replay(cbuf_t *cbuf, const char *path, double speed);
+
+/* Consumer side hook, called from the cbuf publish path */
+void cbuf_tee_capture(cbuf_t *cbuf, const uint8_t *from, const uint8_t *to);
+
+#ifdef __cplusplus
+}
+#endif
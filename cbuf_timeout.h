@@ -59,6 +59,70 @@ void have_highres_mono_clock(void) {
   })
 #endif
 
+/**
+ * cbuf_time_now_usec()
+ *
+ * @brief Get current time in microseconds.
+ */
+
+#ifdef __linux__
+#define cbuf_time_now_usec()                                                   \
+  ({                                                                           \
+    struct timespec ts;                                                        \
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);                                 \
+    int64_t now = (int64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;                \
+    (now);                                                                     \
+  })
+#else /* _MSC_VER */
+#define cbuf_time_now_usec()                                                   \
+  ({                                                                           \
+    LARGE_INTEGER now, freq;                                                   \
+    (void)QueryPerformanceFrequency(&freq);                                    \
+    (void)QueryPerformanceCounter(&now);                                       \
+    int64_t diff = (1000000LL * now.QuadPart) / freq.QuadPart;                 \
+    (diff);                                                                    \
+  })
+#endif
+
+/**
+ * cbuf_time_now_nsec()
+ *
+ * @brief Get current time in nanoseconds.
+ */
+
+#ifdef __linux__
+#define cbuf_time_now_nsec()                                                   \
+  ({                                                                           \
+    struct timespec ts;                                                        \
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);                                 \
+    int64_t now = (int64_t)ts.tv_sec*1000000000 + ts.tv_nsec;                  \
+    (now);                                                                     \
+  })
+#else /* _MSC_VER */
+#define cbuf_time_now_nsec()                                                   \
+  ({                                                                           \
+    LARGE_INTEGER now, freq;                                                   \
+    (void)QueryPerformanceFrequency(&freq);                                    \
+    (void)QueryPerformanceCounter(&now);                                       \
+    int64_t diff = (int64_t)((1000000000.0 * now.QuadPart) / freq.QuadPart);   \
+    (diff);                                                                    \
+  })
+#endif
+
+/**
+ * cbuf_sleep_nsec(nsec)
+ *
+ * @brief Put the calling thread to sleep for about @p nsec nanoseconds.
+ */
+INLINE void cbuf_sleep_nsec(int64_t nsec) {
+#ifdef __linux__
+  struct timespec ts = {nsec / 1000000000, nsec % 1000000000};
+  (void)nanosleep(&ts, NULL);
+#else /* _MSC_VER */
+  Sleep((DWORD)((nsec + 999999) / 1000000));
+#endif
+}
+
 /**
  * cbuf_time_diff(new, old)
  *
@@ -94,3 +158,22 @@ INLINE bool cbuf_timeout_expired(cbuf_timeout_t *timeout) {
   }
   return true;
 }
+
+/**
+ * cbuf_timeout_remaining(timeout)
+ *
+ * @brief Get the milliseconds left before the timeout expires, 0 if it has
+ * expired, or -1 if it never does. Pass this on to a nested wait so that the
+ * whole operation stays within the original timeout.
+ */
+INLINE int64_t cbuf_timeout_remaining(cbuf_timeout_t *timeout) {
+  int64_t left;
+  if (likely(timeout)) {
+    if (timeout->expire_in_msec < 0)
+      return -1;
+    left = timeout->expire_in_msec -
+           cbuf_time_diff(cbuf_time_now(), timeout->begin);
+    return (left > 0) ? left : 0;
+  }
+  return 0;
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include "cbuf_timeout.h"
+#include "defs.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+/**
+ * @brief Typed fixed-element SPSC ring buffers.
+ *
+ * `CBUF_DEFINE_TYPED(name, T, N)` generates a ring buffer type `name##_t`
+ * holding up to @p N elements of type @p T, along with a set of `static
+ * inline` functions prefixed with `name##_`. @p N must be a power of 2 known
+ * at compile time, so that all index math reduces to a constant mask and every
+ * element copy is a fixed-size copy the compiler can inline.
+ *
+ * - Like `cbuf_t`, a typed ring is thread-safe for one reader and one writer
+ * thread. The reader publishes `readi` and the writer publishes `writei` with
+ * release stores, and each side observes the other with acquire loads.
+ *
+ * - `readi` and `writei` are free-running element counters (they are only
+ * reduced modulo @p N when indexing into `buf`), so unlike `cbuf_t` no slot is
+ * reserved to tell a full ring from an empty one; all @p N slots are usable.
+ *
+ * - Each side keeps a private cached copy of the other side's counter, and
+ * only reloads the shared counter when the cached one says the ring is full
+ * (writer) or empty (reader).
+ *
+ * The following functions are generated:
+ *
+ * - `int name##_init(name##_t *r)`
+ *
+ * - `size_t name##_get_capacity(void)`
+ *
+ * - `size_t name##_get_readable_size(name##_t *r)`
+ *
+ * - `int name##_is_empty(name##_t *r)`, `int name##_is_full(name##_t *r)`
+ *
+ * - `int name##_push(name##_t *r, T item, int64_t timeout_msec)`
+ *
+ * - `int name##_pop(name##_t *r, T *item, int64_t timeout_msec)`
+ *
+ * - `ssize_t name##_push_bulk(name##_t *r, const T *items, size_t n,
+ *   int64_t timeout_msec)`
+ *
+ * - `ssize_t name##_pop_bulk(name##_t *r, T *items, size_t n,
+ *   int64_t timeout_msec, bool all)`
+ *
+ * The semantics (return values, timeouts, all-or-nothing behaviour) follow
+ * `cbuf_write_blocking()` and `cbuf_read_blocking()`, counted in elements
+ * rather than bytes.
+ */
+
+/**
+ * cbuf_typed_wait(idx, base, need, timeout_msec)
+ * @brief Wait until `*idx - base >= need` or the timeout expires.
+ *
+ * This is the slow path shared by all the generated typed rings. The writer
+ * waits on the reader's `readi` with `base = writei - N`, and the reader
+ * waits on the writer's `writei` with `base = readi`.
+ *
+ * @return The last observed value of `*idx`.
+ */
+static inline size_t cbuf_typed_wait(_Atomic(size_t) *idx, size_t base,
+                                     size_t need, int64_t timeout_msec) {
+  cbuf_timeout_t timeout;
+  size_t val;
+  /* 32x pauses, 64x pauses x 32 */
+  int pause = 32, pause32 = 64;
+
+  cbuf_timeout_begin(&timeout, timeout_msec);
+  for (;;) {
+    val = atomic_load_explicit(idx, memory_order_acquire);
+    if (val - base >= need)
+      break;
+
+    if (cbuf_timeout_expired(&timeout))
+      break;
+
+    decaying_sleep(pause, pause32);
+  }
+
+  return val;
+}
+
+#define CBUF_TYPED_IS_POW2(n) (((n) != 0) && (((n) & ((n) - 1)) == 0))
+
+#define CBUF_DEFINE_TYPED(name, T, N)                                          \
+  _Static_assert(CBUF_TYPED_IS_POW2(N), #name ": N must be a power of 2");     \
+                                                                               \
+  typedef struct name##_st {                                                   \
+    /* writer cache line */                                                    \
+    _Alignas(CACHELINE_SIZE) _Atomic(size_t) writei;                           \
+    size_t readi_cache;                                                        \
+    /* reader cache line */                                                    \
+    _Alignas(CACHELINE_SIZE) _Atomic(size_t) readi;                            \
+    size_t writei_cache;                                                       \
+    _Alignas(CACHELINE_SIZE) T buf[N];                                         \
+  } name##_t;                                                                  \
+                                                                               \
+  static inline int name##_init(name##_t *r) {                                 \
+    if (!r)                                                                    \
+      return -1;                                                               \
+    atomic_init(&r->writei, 0);                                                \
+    atomic_init(&r->readi, 0);                                                 \
+    r->readi_cache = 0;                                                        \
+    r->writei_cache = 0;                                                       \
+    return 0;                                                                  \
+  }                                                                            \
+                                                                               \
+  static inline size_t name##_get_capacity(void) { return (N); }               \
+                                                                               \
+  static inline size_t name##_get_readable_size(name##_t *r) {                 \
+    size_t readi, writei;                                                      \
+    if (unlikely(!r))                                                          \
+      return 0;                                                                \
+    readi = atomic_load(&r->readi);                                            \
+    writei = atomic_load(&r->writei);                                          \
+    return writei - readi;                                                     \
+  }                                                                            \
+                                                                               \
+  static inline int name##_is_empty(name##_t *r) {                             \
+    if (unlikely(!r))                                                          \
+      return -1;                                                               \
+    return name##_get_readable_size(r) == 0;                                   \
+  }                                                                            \
+                                                                               \
+  static inline int name##_is_full(name##_t *r) {                              \
+    if (unlikely(!r))                                                          \
+      return -1;                                                               \
+    return name##_get_readable_size(r) == (N);                                 \
+  }                                                                            \
+                                                                               \
+  static inline int name##_push(name##_t *r, T item, int64_t timeout_msec) {   \
+    size_t writei;                                                             \
+    if (unlikely(!r))                                                          \
+      return -1;                                                               \
+    writei = atomic_load_explicit(&r->writei, memory_order_relaxed);           \
+    if (unlikely(writei - r->readi_cache >= (N))) {                            \
+      r->readi_cache = cbuf_typed_wait(&r->readi, writei - (N), 1,             \
+                                       timeout_msec);                          \
+      if (writei - r->readi_cache >= (N))                                      \
+        return 0; /* timed out with no free slot */                            \
+    }                                                                          \
+    r->buf[writei & ((N) - 1)] = item;                                         \
+    atomic_store_explicit(&r->writei, writei + 1, memory_order_release);       \
+    return 1;                                                                  \
+  }                                                                            \
+                                                                               \
+  static inline int name##_pop(name##_t *r, T *item, int64_t timeout_msec) {   \
+    size_t readi;                                                              \
+    if (unlikely(!r || !item))                                                 \
+      return -1;                                                               \
+    readi = atomic_load_explicit(&r->readi, memory_order_relaxed);             \
+    if (unlikely(r->writei_cache == readi)) {                                  \
+      r->writei_cache = cbuf_typed_wait(&r->writei, readi, 1, timeout_msec);   \
+      if (r->writei_cache == readi)                                            \
+        return 0; /* timed out with nothing to read */                         \
+    }                                                                          \
+    *item = r->buf[readi & ((N) - 1)];                                         \
+    atomic_store_explicit(&r->readi, readi + 1, memory_order_release);         \
+    return 1;                                                                  \
+  }                                                                            \
+                                                                               \
+  static inline ssize_t name##_push_bulk(name##_t *r, const T *items,          \
+                                         size_t n, int64_t timeout_msec) {     \
+    size_t writei, offs, len;                                                  \
+    if (!r || !items || (n > (N)))                                             \
+      return -1;                                                               \
+    writei = atomic_load_explicit(&r->writei, memory_order_relaxed);           \
+    if ((N) - (writei - r->readi_cache) < n) {                                 \
+      r->readi_cache = cbuf_typed_wait(&r->readi, writei - (N), n,             \
+                                       timeout_msec);                          \
+      if ((N) - (writei - r->readi_cache) < n)                                 \
+        return 0; /* timed out without enough free slots */                    \
+    }                                                                          \
+    /* Two-phase copy; write up to the end of the buffer, then wrap */         \
+    offs = writei & ((N) - 1);                                                 \
+    len = MIN((N) - offs, n);                                                  \
+    memcpy(&r->buf[offs], items, len * sizeof(T));                             \
+    if (n - len)                                                               \
+      memcpy(&r->buf[0], items + len, (n - len) * sizeof(T));                  \
+    atomic_store_explicit(&r->writei, writei + n, memory_order_release);       \
+    return n;                                                                  \
+  }                                                                            \
+                                                                               \
+  static inline ssize_t name##_pop_bulk(name##_t *r, T *items, size_t n,       \
+                                        int64_t timeout_msec, bool all) {      \
+    size_t readi, nread, offs, len;                                            \
+    if (!r || !items || (n > (N)))                                             \
+      return -1;                                                               \
+    readi = atomic_load_explicit(&r->readi, memory_order_relaxed);             \
+    if (r->writei_cache - readi < n)                                           \
+      r->writei_cache = cbuf_typed_wait(&r->writei, readi, n, timeout_msec);   \
+    nread = r->writei_cache - readi;                                           \
+    if (!nread || (all && (nread < n)))                                        \
+      return 0;                                                                \
+    nread = MIN(nread, n);                                                     \
+    /* Read up to the end of the buffer, then wrap */                          \
+    offs = readi & ((N) - 1);                                                  \
+    len = MIN((N) - offs, nread);                                              \
+    memcpy(items, &r->buf[offs], len * sizeof(T));                             \
+    if (nread - len)                                                           \
+      memcpy(items + len, &r->buf[0], (nread - len) * sizeof(T));              \
+    atomic_store_explicit(&r->readi, readi + nread, memory_order_release);     \
+    return nread;                                                              \
+  }                                                                            \
+                                                                               \
+  _Static_assert(1, "") /* require a trailing semicolon */
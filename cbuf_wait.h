@@ -0,0 +1,86 @@
+#pragma once
+
+/**
+ * Internal: the waiter behind every blocking call of the library, so that
+ * the extensions waiting on a cbuf (or a set of them) follow the same
+ * adaptive schedule as the core read/write paths. See
+ * `cbuf_set_adaptive_wait()`.
+ */
+
+#include "cbuf.h"
+#include "cbuf_timeout.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Adaptive waiting: yield for up to this many park costs, then sleep */
+#define CBUF_WAIT_SLEEP_FACTOR 20
+/* Adaptive waiting: the latest wait has a weight of 1/8 in the EWMA */
+#define CBUF_WAIT_EWMA_DIV 8
+
+/**
+ * @struct cbuf_waiter_t
+ * @brief State of one blocking call that may have to wait, see
+ * `cbuf_set_adaptive_wait()`.
+ *
+ * Without adaptive waiting this is just the `decaying_sleep()` schedule.
+ */
+typedef struct cbuf_waiter_st {
+  cbuf_wait_stats_t *stats; /* NULL unless adaptive waiting is enabled */
+  int64_t park_nsec;
+  int64_t begin; /* time of the first retry, 0 before it */
+  cbuf_wait_mode_t mode;
+  /* 32x pauses, 64x pauses x 32 */
+  int pause, pause32;
+} cbuf_waiter_t;
+
+void cbuf_waiter_adapt(cbuf_waiter_t *w);
+
+/* Start a call that learns from, and updates, @p stats; NULL for none */
+INLINE void cbuf_waiter_init(cbuf_waiter_t *w, cbuf_wait_stats_t *stats,
+                             int64_t park_nsec) {
+  w->stats = stats;
+  w->pause = 32;
+  w->pause32 = 64;
+  if (unlikely(stats)) {
+    w->park_nsec = park_nsec;
+    w->begin = 0;
+  }
+}
+
+/* Start a call waiting on the @p side of @p cbuf */
+INLINE void cbuf_waiter_begin(cbuf_waiter_t *w, cbuf_t *cbuf,
+                              cbuf_side_t side) {
+  cbuf_wait_stats_t *stats = NULL;
+
+  if (unlikely(cbuf->flags & CBUF_F_ADAPTIVE))
+    stats = (side == CBUF_READER) ? &cbuf->read_wait : &cbuf->write_wait;
+  cbuf_waiter_init(w, stats, cbuf->park_nsec);
+}
+
+/* Back off before retrying a blocking call */
+INLINE void cbuf_waiter_wait(cbuf_waiter_t *w) {
+  if (likely(!w->stats))
+    decaying_sleep(w->pause, w->pause32);
+  else
+    cbuf_waiter_adapt(w);
+}
+
+/* Fold the duration of a finished wait into the expected wait */
+INLINE void cbuf_waiter_end(cbuf_waiter_t *w) {
+  int64_t sample;
+
+  if (likely(!w->stats) || !w->begin)
+    return;
+
+  sample = cbuf_time_now_nsec() - w->begin;
+  if (!w->stats->ewma_nsec)
+    w->stats->ewma_nsec = sample;
+  else
+    w->stats->ewma_nsec += (sample - w->stats->ewma_nsec) / CBUF_WAIT_EWMA_DIV;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,574 @@
+#include "cbuf_zblock.h"
+#include "cbuf_timeout.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * LZ77 codec
+ *
+ * A compressed block is a sequence of (literals, match) pairs, each encoded
+ * as
+ *
+ * - a token byte: literal length in the high nibble, match length - 4 in the
+ * low nibble, where 15 means "add the following bytes until one is not 255",
+ *
+ * - the literals,
+ *
+ * - the match offset, 16 bit little endian, then any match length bytes.
+ *
+ * The last pair has literals only and ends the block. The decoder checks
+ * every length and offset against both buffers, so a corrupt block is
+ * rejected instead of reading or writing out of bounds.
+ */
+
+#define LZ_MIN_MATCH 4U
+#define LZ_MAX_OFFSET 0xffffU
+/* Literal runs up to this long are copied with a single fixed size copy */
+#define LZ_FAST_COPY 16U
+/* Skip ahead faster through data that does not compress */
+#define LZ_SKIP_SHIFT 6U
+
+INLINE uint32_t lz_read32(const uint8_t *p) {
+  uint32_t v;
+
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+INLINE uint64_t lz_read64(const uint8_t *p) {
+  uint64_t v;
+
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+/* Length of the common prefix of @p a and @p b, stopping at @p end */
+INLINE size_t lz_count(const uint8_t *a, const uint8_t *b,
+                       const uint8_t *end) {
+  const uint8_t *start = a;
+  uint64_t diff;
+
+  while ((size_t)(end - a) >= sizeof(diff)) {
+    diff = lz_read64(a) ^ lz_read64(b);
+    if (diff)
+      return (size_t)(a - start) + (__builtin_ctzll(diff) >> 3);
+    a += sizeof(diff);
+    b += sizeof(diff);
+  }
+  while ((a < end) && (*a == *b)) {
+    a++;
+    b++;
+  }
+  return (size_t)(a - start);
+}
+
+INLINE uint32_t lz_hash(uint32_t v) {
+  return (v * 2654435761U) >> (32 - CBUF_Z_HASH_LOG);
+}
+
+/* Write a length continuation; returns false if it does not fit */
+INLINE bool lz_put_len(uint8_t **op, const uint8_t *end, size_t len) {
+  for (; len >= 255; len -= 255) {
+    if (*op >= end)
+      return false;
+    *(*op)++ = 255;
+  }
+  if (*op >= end)
+    return false;
+  *(*op)++ = (uint8_t)len;
+  return true;
+}
+
+/* Emit one pair; @p mlen is 0 for the final, literals only, pair */
+static bool lz_emit(uint8_t **op, const uint8_t *end, const uint8_t *lit,
+                    size_t litlen, size_t offset, size_t mlen) {
+  uint8_t *token;
+  size_t mcode = mlen ? mlen - LZ_MIN_MATCH : 0;
+
+  if (*op >= end)
+    return false;
+  token = (*op)++;
+  *token = (uint8_t)((MIN(litlen, 15U) << 4) | MIN(mcode, 15U));
+
+  if ((litlen >= 15) && !lz_put_len(op, end, litlen - 15))
+    return false;
+  if ((size_t)(end - *op) < litlen)
+    return false;
+  memcpy(*op, lit, litlen);
+  *op += litlen;
+
+  if (!mlen)
+    return true;
+
+  if (end - *op < 2)
+    return false;
+  *(*op)++ = (uint8_t)offset;
+  *(*op)++ = (uint8_t)(offset >> 8);
+
+  if ((mcode >= 15) && !lz_put_len(op, end, mcode - 15))
+    return false;
+  return true;
+}
+
+/**
+ * @param[in] src The data to compress.
+ * @param[in] n The size of @p src, at most `CBUF_Z_MAX_BLOCK`.
+ * @param[out] dst The buffer to compress into.
+ * @param[in] cap The size of @p dst; `CBUF_Z_BOUND(n)` always suffices.
+ * @param[in] table Scratch space for `1 << CBUF_Z_HASH_LOG` entries.
+ * @return The compressed size, or 0 if it does not fit in @p cap bytes.
+ *
+ * @brief Compress a block with the built-in LZ77 codec. Passing a @p cap
+ * smaller than @p n gives up as soon as the block would not shrink.
+ */
+size_t cbuf_lz_compress(const uint8_t *src, size_t n, uint8_t *dst,
+                        size_t cap, uint32_t *table) {
+  const uint8_t *anchor = src, *ip = src, *end = src + n, *cand;
+  uint8_t *op = dst, *oend = dst + cap;
+  size_t mlen, step, misses = 0;
+  uint32_t seq, h;
+
+  if (!src || !dst || !table || (n > CBUF_Z_MAX_BLOCK))
+    return 0;
+
+  memset(table, 0, sizeof(*table) << CBUF_Z_HASH_LOG);
+
+  while ((size_t)(end - ip) >= LZ_MIN_MATCH) {
+    seq = lz_read32(ip);
+    h = lz_hash(seq);
+    cand = src + table[h];
+    table[h] = (uint32_t)(ip - src);
+
+    if ((cand >= ip) || ((size_t)(ip - cand) > LZ_MAX_OFFSET) ||
+        (lz_read32(cand) != seq)) {
+      step = 1 + (misses++ >> LZ_SKIP_SHIFT);
+      ip += MIN(step, (size_t)(end - ip));
+      continue;
+    }
+
+    /* Extend the match backwards over pending literals, then forwards */
+    while ((ip > anchor) && (cand > src) && (ip[-1] == cand[-1])) {
+      ip--;
+      cand--;
+    }
+    mlen = LZ_MIN_MATCH +
+           lz_count(ip + LZ_MIN_MATCH, cand + LZ_MIN_MATCH, end);
+
+    if (!lz_emit(&op, oend, anchor, (size_t)(ip - anchor), (size_t)(ip - cand),
+                 mlen))
+      return 0;
+
+    ip += mlen;
+    anchor = ip;
+    misses = 0;
+
+    /* Let the next match start inside this one */
+    if (end - ip >= 2)
+      table[lz_hash(lz_read32(ip - 2))] = (uint32_t)(ip - 2 - src);
+  }
+
+  if (!lz_emit(&op, oend, anchor, (size_t)(end - anchor), 0, 0))
+    return 0;
+
+  return (size_t)(op - dst);
+}
+
+/* Read a length continuation; returns false on truncated input */
+INLINE bool lz_get_len(const uint8_t **ip, const uint8_t *end, size_t *len) {
+  uint8_t b;
+
+  do {
+    if (*ip >= end)
+      return false;
+    b = *(*ip)++;
+    *len += b;
+  } while (b == 255);
+  return true;
+}
+
+/**
+ * @param[in] src The compressed block.
+ * @param[in] n The size of @p src.
+ * @param[out] dst The buffer to decompress into.
+ * @param[in] cap The size of @p dst.
+ * @return The decompressed size, or -1 if the block is corrupt or does not
+ * fit in @p cap bytes.
+ *
+ * @brief Decompress a block produced by `cbuf_lz_compress()`.
+ */
+ssize_t cbuf_lz_decompress(const uint8_t *src, size_t n, uint8_t *dst,
+                           size_t cap) {
+  const uint8_t *ip = src, *end = src + n, *match;
+  uint8_t *op = dst, *oend = dst + cap;
+  size_t litlen, mlen, offset;
+  uint8_t token;
+
+  if (!src || !dst)
+    return -1;
+
+  for (;;) {
+    if (ip >= end)
+      return -1;
+    token = *ip++;
+
+    litlen = token >> 4;
+    if ((litlen == 15) && !lz_get_len(&ip, end, &litlen))
+      return -1;
+    if (((size_t)(end - ip) < litlen) || ((size_t)(oend - op) < litlen))
+      return -1;
+    /* Short runs are copied with one fixed size copy when there is room */
+    if ((litlen <= LZ_FAST_COPY) && ((size_t)(end - ip) >= LZ_FAST_COPY) &&
+        ((size_t)(oend - op) >= LZ_FAST_COPY))
+      memcpy(op, ip, LZ_FAST_COPY);
+    else
+      memcpy(op, ip, litlen);
+    ip += litlen;
+    op += litlen;
+
+    if (ip == end)
+      break; /* last pair */
+
+    if (end - ip < 2)
+      return -1;
+    offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+    ip += 2;
+    if (!offset || (offset > (size_t)(op - dst)))
+      return -1;
+
+    mlen = token & 15;
+    if ((mlen == 15) && !lz_get_len(&ip, end, &mlen))
+      return -1;
+    mlen += LZ_MIN_MATCH;
+    if ((size_t)(oend - op) < mlen)
+      return -1;
+
+    /* Matches may overlap their own output */
+    match = op - offset;
+    if ((offset >= sizeof(uint64_t)) &&
+        ((size_t)(oend - op) >= mlen + sizeof(uint64_t))) {
+      /* May write up to 7 bytes past the match, which are overwritten next */
+      for (size_t i = 0; i < mlen; i += sizeof(uint64_t))
+        memcpy(op + i, match + i, sizeof(uint64_t));
+      op += mlen;
+    } else {
+      while (mlen--)
+        *op++ = *match++;
+    }
+  }
+
+  return (ssize_t)(op - dst);
+}
+
+/**
+ * @param[in] w The writer to initialize.
+ * @param[in] cbuf An initialized cbuf instance.
+ * @param[in] block_size The max uncompressed size of a block, at most
+ * `CBUF_Z_MAX_BLOCK`. The reader must use the same or a larger block size.
+ * @return 0 on success, -1 for invalid arguments, if the largest possible
+ * block does not fit in @p cbuf, or if an allocation fails.
+ */
+int cbuf_zwriter_init(cbuf_zwriter_t *w, cbuf_t *cbuf, size_t block_size) {
+  if (!w || !cbuf || !block_size || (block_size > CBUF_Z_MAX_BLOCK))
+    return -1;
+
+  /* A block that does not shrink is stored as is */
+  if (sizeof(cbuf_zblock_hdr_t) + block_size > cbuf_get_capacity(cbuf))
+    return -1;
+
+  memset(w, 0, sizeof(*w));
+  w->cbuf = cbuf;
+  w->block_size = block_size;
+  w->block = malloc(block_size);
+  w->out = malloc(sizeof(cbuf_zblock_hdr_t) + block_size);
+  w->table = malloc(sizeof(*w->table) << CBUF_Z_HASH_LOG);
+  if (!w->block || !w->out || !w->table) {
+    cbuf_zwriter_free(w);
+    return -1;
+  }
+
+  return 0;
+}
+
+/**
+ * @param[in] w The writer to free.
+ *
+ * @brief Free the writer. Data not yet flushed with `cbuf_zflush()` is lost.
+ */
+void cbuf_zwriter_free(cbuf_zwriter_t *w) {
+  if (!w)
+    return;
+
+  free(w->block);
+  free(w->out);
+  free(w->table);
+  w->block = w->out = NULL;
+  w->table = NULL;
+}
+
+/**
+ * Compress the collected block (unless a previous attempt already did) and
+ * publish it as one record.
+ *
+ * @return 1 on success, 0 on timeout; the compressed block is kept for the
+ * next attempt.
+ */
+static int zwriter_publish(cbuf_zwriter_t *w, int64_t timeout_msec) {
+  cbuf_zblock_hdr_t hdr;
+  uint8_t *payload = w->out + sizeof(hdr);
+  size_t len;
+  int64_t begin;
+  ssize_t ret;
+
+  if (!w->zlen) {
+    begin = cbuf_time_now_nsec();
+    len = cbuf_lz_compress(w->block, w->fill, payload, w->fill - 1, w->table);
+    if (!len) {
+      memcpy(payload, w->block, w->fill);
+      len = w->fill;
+    }
+    w->stats.nsec += cbuf_time_now_nsec() - begin;
+
+    hdr.len = (uint32_t)len;
+    hdr.raw_len = (uint32_t)w->fill;
+    memcpy(w->out, &hdr, sizeof(hdr));
+    w->zlen = sizeof(hdr) + len;
+  }
+
+  ret = cbuf_write_blocking(w->cbuf, w->out, w->zlen, timeout_msec);
+  if (ret <= 0)
+    return (int)ret;
+
+  w->stats.blocks++;
+  w->stats.raw_bytes += w->fill;
+  w->stats.z_bytes += w->zlen;
+  w->fill = 0;
+  w->zlen = 0;
+
+  return 1;
+}
+
+/**
+ * @param[in] w An initialized writer.
+ * @param[in] buf The data to write.
+ * @param[in] nbytes The number of bytes to write.
+ * @param[in] timeout_msec The wait timeout (in milliseconds).
+ * @return The number of bytes accepted, 0 on timeout, -1 for invalid
+ * arguments.
+ *
+ * @brief Append @p buf to the current block, publishing each block as it
+ * fills up and waiting for at most @p timeout_msec ms in total for space in
+ * the cbuf, however many blocks @p buf fills. Data is not visible to the
+ * reader until its block is published; use `cbuf_zflush()` to publish a
+ * partial block.
+ *
+ * Returns less than @p nbytes if the timeout expires before every full block
+ * could be published.
+ * All the bytes accepted are kept and published on a later call.
+ *
+ * The following values of @p timeout_msec are special:
+ *
+ * - `0`: return immediately
+ *
+ * - `-1`: wait indefinitely
+ */
+ssize_t cbuf_zwrite(cbuf_zwriter_t *w, const uint8_t *buf, size_t nbytes,
+                    int64_t timeout_msec) {
+  cbuf_timeout_t timeout;
+  size_t done = 0, n;
+  int ret;
+
+  if (!w || !w->block || !buf)
+    return -1;
+
+  /* All the blocks published by this call share one deadline */
+  cbuf_timeout_begin(&timeout, timeout_msec);
+  do {
+    n = MIN(w->block_size - w->fill, nbytes - done);
+    memcpy(w->block + w->fill, buf + done, n);
+    w->fill += n;
+    done += n;
+
+    if (w->fill == w->block_size) {
+      ret = zwriter_publish(w, cbuf_timeout_remaining(&timeout));
+      if (ret <= 0)
+        break;
+    }
+  } while (done < nbytes);
+
+  return (ssize_t)done;
+}
+
+/**
+ * @param[in] w An initialized writer.
+ * @param[in] timeout_msec The wait timeout (in milliseconds).
+ * @return 1 on success or if there was nothing to publish, 0 on timeout, -1
+ * for invalid arguments.
+ *
+ * @brief Publish the current partial block.
+ *
+ * The following values of @p timeout_msec are special:
+ *
+ * - `0`: return immediately
+ *
+ * - `-1`: wait indefinitely
+ */
+int cbuf_zflush(cbuf_zwriter_t *w, int64_t timeout_msec) {
+  if (!w || !w->block)
+    return -1;
+
+  if (!w->fill)
+    return 1;
+
+  return zwriter_publish(w, timeout_msec);
+}
+
+/**
+ * @param[in] r The reader to initialize.
+ * @param[in] cbuf An initialized cbuf instance.
+ * @param[in] block_size The max uncompressed size of a block; at least the
+ * writer's block size.
+ * @return 0 on success, -1 for invalid arguments or if an allocation fails.
+ */
+int cbuf_zreader_init(cbuf_zreader_t *r, cbuf_t *cbuf, size_t block_size) {
+  if (!r || !cbuf || !block_size || (block_size > CBUF_Z_MAX_BLOCK))
+    return -1;
+
+  memset(r, 0, sizeof(*r));
+  r->cbuf = cbuf;
+  r->block_size = block_size;
+  r->block = malloc(block_size);
+  r->scratch = malloc(block_size);
+  if (!r->block || !r->scratch) {
+    cbuf_zreader_free(r);
+    return -1;
+  }
+
+  return 0;
+}
+
+/**
+ * @param[in] r The reader to free.
+ */
+void cbuf_zreader_free(cbuf_zreader_t *r) {
+  if (!r)
+    return;
+
+  free(r->block);
+  free(r->scratch);
+  r->block = r->scratch = NULL;
+}
+
+/**
+ * Decompress the next block into `r->block`.
+ *
+ * @return 1 on success, 0 on timeout, -1 if the block is corrupt or larger
+ * than the reader's block size (it is left in the cbuf).
+ */
+static int zreader_next(cbuf_zreader_t *r, int64_t timeout_msec) {
+  cbuf_zblock_hdr_t hdr;
+  cbuf_timeout_t timeout;
+  cbuf_segs_t segs;
+  const uint8_t *src;
+  int64_t begin;
+  ssize_t len;
+  int ret;
+
+  /* Both waits share one deadline */
+  cbuf_timeout_begin(&timeout, timeout_msec);
+  ret = cbuf_waitfor_readable(r->cbuf, sizeof(hdr), timeout_msec);
+  if (ret <= 0)
+    return ret;
+
+  (void)cbuf_peek(r->cbuf, (uint8_t *)&hdr, sizeof(hdr));
+  if (!hdr.raw_len || (hdr.raw_len > r->block_size) || !hdr.len ||
+      (hdr.len > hdr.raw_len))
+    return -1;
+
+  /* Blocks are published whole, but do not rely on it for foreign writers */
+  ret = cbuf_waitfor_readable(r->cbuf, sizeof(hdr) + hdr.len,
+                              cbuf_timeout_remaining(&timeout));
+  if (ret <= 0)
+    return ret;
+
+  (void)cbuf_view_at(r->cbuf, sizeof(hdr), hdr.len, &segs);
+  src = segs.ptr[0];
+  if (segs.len[1]) {
+    memcpy(r->scratch, segs.ptr[0], segs.len[0]);
+    memcpy(r->scratch + segs.len[0], segs.ptr[1], segs.len[1]);
+    src = r->scratch;
+  }
+
+  begin = cbuf_time_now_nsec();
+  if (hdr.len == hdr.raw_len) {
+    memcpy(r->block, src, hdr.len);
+    len = hdr.len;
+  } else {
+    len = cbuf_lz_decompress(src, hdr.len, r->block, hdr.raw_len);
+  }
+  r->stats.nsec += cbuf_time_now_nsec() - begin;
+
+  if (len != (ssize_t)hdr.raw_len)
+    return -1;
+
+  (void)cbuf_remove(r->cbuf, sizeof(hdr) + hdr.len);
+
+  r->stats.blocks++;
+  r->stats.raw_bytes += hdr.raw_len;
+  r->stats.z_bytes += sizeof(hdr) + hdr.len;
+  r->len = hdr.raw_len;
+  r->pos = 0;
+
+  return 1;
+}
+
+/**
+ * @param[in] r An initialized reader.
+ * @param[out] buf The buffer to read into.
+ * @param[in] nbytes The max number of bytes to read.
+ * @param[in] timeout_msec The wait timeout (in milliseconds).
+ * @return The number of bytes read, 0 on timeout, -1 for invalid arguments
+ * or a corrupt block.
+ *
+ * @brief Read at most @p nbytes of decompressed data, waiting for at most
+ * @p timeout_msec ms for a block if none is pending. Never returns data from
+ * more than one block.
+ *
+ * The following values of @p timeout_msec are special:
+ *
+ * - `0`: return immediately
+ *
+ * - `-1`: wait indefinitely
+ */
+ssize_t cbuf_zread(cbuf_zreader_t *r, uint8_t *buf, size_t nbytes,
+                   int64_t timeout_msec) {
+  size_t n;
+  int ret;
+
+  if (!r || !r->block || !buf || !nbytes)
+    return -1;
+
+  if (r->pos == r->len) {
+    ret = zreader_next(r, timeout_msec);
+    if (ret <= 0)
+      return ret;
+  }
+
+  n = MIN(nbytes, r->len - r->pos);
+  memcpy(buf, r->block + r->pos, n);
+  r->pos += n;
+
+  return (ssize_t)n;
+}
+
+/**
+ * @param[in] stats Writer or reader statistics.
+ * @return The compression ratio so far (uncompressed / stored size), or 0 if
+ * no block was processed yet.
+ */
+double cbuf_zstats_ratio(const cbuf_zstats_t *stats) {
+  if (!stats || !stats->z_bytes)
+    return 0;
+
+  return (double)stats->raw_bytes / (double)stats->z_bytes;
+}
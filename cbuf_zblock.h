@@ -0,0 +1,104 @@
+#pragma once
+
+#include "cbuf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Max uncompressed size of a block; keeps every match offset within 16 bits */
+#define CBUF_Z_MAX_BLOCK (64U << 10)
+
+/* Log2 of the number of match finder hash table entries */
+#define CBUF_Z_HASH_LOG 12U
+
+/* Worst case size of a compressed block of @p n bytes */
+#define CBUF_Z_BOUND(n) ((n) + ((n) / 255) + 16)
+
+/**
+ * @struct cbuf_zblock_hdr_t
+ * @brief Header in front of every block in a compressed cbuf.
+ *
+ * A block that did not shrink is stored as is, with `len == raw_len`.
+ */
+typedef struct cbuf_zblock_hdr_st {
+  uint32_t len;     /* size of the block in the cbuf, excluding this header */
+  uint32_t raw_len; /* size of the block once decompressed */
+} cbuf_zblock_hdr_t;
+
+/**
+ * @struct cbuf_zstats_t
+ * @brief Compression statistics of one side of a compressed cbuf.
+ */
+typedef struct cbuf_zstats_st {
+  uint64_t blocks;    /* blocks published (writer) or consumed (reader) */
+  uint64_t raw_bytes; /* uncompressed bytes */
+  uint64_t z_bytes;   /* bytes in the cbuf, headers included */
+  uint64_t nsec;      /* time spent compressing or decompressing */
+} cbuf_zstats_t;
+
+/**
+ * @struct cbuf_zwriter_t
+ * @brief Producer side of a compressed cbuf.
+ *
+ * Writes are collected into blocks of up to `block_size` bytes. A full block
+ * (or the partial block on `cbuf_zflush()`) is compressed with a small
+ * built-in LZ77 codec and published as one record, so the cbuf holds, and
+ * memory traffic carries, only the compressed bytes.
+ *
+ * Only the writer may use this.
+ */
+typedef struct cbuf_zwriter_st {
+  cbuf_t *cbuf;
+  size_t block_size;
+  size_t fill;     /* bytes collected in `block` */
+  size_t zlen;     /* size of the compressed record in `out`, 0 if none */
+  uint8_t *block;  /* block being collected */
+  uint8_t *out;    /* header + compressed block, ready to publish */
+  uint32_t *table; /* match finder hash table */
+  cbuf_zstats_t stats;
+} cbuf_zwriter_t;
+
+/**
+ * @struct cbuf_zreader_t
+ * @brief Consumer side of a compressed cbuf.
+ *
+ * Only the reader may use this.
+ */
+typedef struct cbuf_zreader_st {
+  cbuf_t *cbuf;
+  size_t block_size;
+  size_t len;       /* bytes in `block` */
+  size_t pos;       /* bytes of `block` already returned */
+  uint8_t *block;   /* last decompressed block */
+  uint8_t *scratch; /* compressed block that wrapped around the cbuf */
+  cbuf_zstats_t stats;
+} cbuf_zreader_t;
+
+int cbuf_zwriter_init(cbuf_zwriter_t *w, cbuf_t *cbuf, size_t block_size);
+
+void cbuf_zwriter_free(cbuf_zwriter_t *w);
+
+ssize_t cbuf_zwrite(cbuf_zwriter_t *w, const uint8_t *buf, size_t nbytes,
+                    int64_t timeout_msec);
+
+int cbuf_zflush(cbuf_zwriter_t *w, int64_t timeout_msec);
+
+int cbuf_zreader_init(cbuf_zreader_t *r, cbuf_t *cbuf, size_t block_size);
+
+void cbuf_zreader_free(cbuf_zreader_t *r);
+
+ssize_t cbuf_zread(cbuf_zreader_t *r, uint8_t *buf, size_t nbytes,
+                   int64_t timeout_msec);
+
+double cbuf_zstats_ratio(const cbuf_zstats_t *stats);
+
+size_t cbuf_lz_compress(const uint8_t *src, size_t n, uint8_t *dst,
+                        size_t cap, uint32_t *table);
+
+ssize_t cbuf_lz_decompress(const uint8_t *src, size_t n, uint8_t *dst,
+                           size_t cap);
+
+#ifdef __cplusplus
+}
+#endif
@@ -38,6 +38,10 @@
 #define INLINE static inline __forceinline
 #endif
 
+#ifndef CACHELINE_SIZE
+#define CACHELINE_SIZE 64
+#endif
+
 #define MIN(a, b) ((b) ^ (((a) ^ (b)) & -((a) < (b))))
 #define MAX(a, b) ((a) ^ (((a) ^ (b)) & -((a) < (b))))
 
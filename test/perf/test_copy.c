@@ -0,0 +1,112 @@
+#include "cbuf_copy.h"
+#include "cbuf_timeout.h"
+#include "test_utils.h"
+
+/**
+ * Large-copy benchmark: push big chunks through a ring with each copy kernel
+ * and report
+ *
+ * - write throughput (producer side copy into the ring),
+ *
+ * - the time to walk a small "hot" working set right after each write, as a
+ *   proxy for how much of the producer's cache the copy evicted,
+ *
+ * - read throughput (consumer side copy out of the ring).
+ */
+
+#define RING_SIZE (64U << 20)
+#define CHUNK_SIZE (4U << 20)
+#define HOT_SIZE (1U << 20)
+#define ITERS 32
+
+static int64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t walk(const volatile uint64_t *hot) {
+  uint64_t sum = 0;
+  for (size_t i = 0; i < HOT_SIZE / sizeof(*hot); i += 8)
+    sum += hot[i];
+  return sum;
+}
+
+static void run(const char *name, cbuf_t *cbuf, const uint8_t *src,
+                uint8_t *dst, const uint64_t *hot) {
+  int64_t t_write = 0, t_hot = 0, t_read = 0, t;
+  uint64_t sink = 0;
+
+  for (int i = 0; i < ITERS; i++) {
+    sink += walk(hot);
+
+    t = now_ns();
+    TEST_ASSERT(cbuf_write_blocking(cbuf, src, CHUNK_SIZE, 0) == CHUNK_SIZE,
+                "Write failed");
+    t_write += now_ns() - t;
+
+    t = now_ns();
+    sink += walk(hot);
+    t_hot += now_ns() - t;
+
+    t = now_ns();
+    TEST_ASSERT(cbuf_read_blocking(cbuf, dst, CHUNK_SIZE, 0, true) ==
+                    CHUNK_SIZE,
+                "Read failed");
+    t_read += now_ns() - t;
+    TEST_ASSERT(!memcmp(src, dst, CHUNK_SIZE), "Data mismatch");
+  }
+
+  printf("%-10s %12.2f %14.1f %12.2f   (%llu)\n", name,
+         (double)CHUNK_SIZE * ITERS / t_write,
+         (double)t_hot / ITERS / 1000.0, (double)CHUNK_SIZE * ITERS / t_read,
+         (unsigned long long)(sink & 0xF));
+}
+
+int main() {
+  static const struct {
+    cbuf_copy_kernel_t kernel;
+    const char *name;
+  } kernels[] = {
+      {CBUF_COPY_MEMCPY, "memcpy"},
+      {CBUF_COPY_SSE2, "sse2-nt"},
+      {CBUF_COPY_AVX2, "avx2-nt"},
+      {CBUF_COPY_AVX512, "avx512-nt"},
+  };
+  cbuf_t cbuf;
+  uint8_t *src = malloc(CHUNK_SIZE), *dst = malloc(CHUNK_SIZE);
+  uint64_t *hot = malloc(HOT_SIZE);
+
+  TEST_ASSERT(src && dst && hot, "Allocation failed");
+  TEST_ASSERT(cbuf_init(&cbuf, RING_SIZE) == 0, "Failed to initialize buffer");
+
+  for (size_t i = 0; i < CHUNK_SIZE; i++)
+    src[i] = (i * 131) & 0xFF;
+  memset(dst, 0, CHUNK_SIZE);
+  memset(hot, 1, HOT_SIZE);
+  /* Fault in the whole ring once */
+  memset(cbuf.buf, 0, RING_SIZE);
+
+  printf("%d x %u KiB chunks, %u KiB hot set, NT threshold %zu KiB\n", ITERS,
+         CHUNK_SIZE >> 10, HOT_SIZE >> 10, cbuf_copy_get_nt_threshold() >> 10);
+  printf("%-10s %12s %14s %12s\n", "kernel", "write GB/s", "hot walk (us)",
+         "read GB/s");
+
+  for (size_t k = 0; k < ARR_COUNT(kernels); k++) {
+    if (cbuf_copy_select(kernels[k].kernel) != 0) {
+      printf("%-10s (not supported on this CPU)\n", kernels[k].name);
+      continue;
+    }
+    TEST_ASSERT(cbuf_copy_get_kernel() == kernels[k].kernel,
+                "Kernel selection failed");
+    run(kernels[k].name, &cbuf, src, dst, hot);
+  }
+
+  TEST_ASSERT(cbuf_copy_select(CBUF_COPY_AUTO) == 0, "Auto selection failed");
+
+  cbuf_free(&cbuf);
+  free(src);
+  free(dst);
+  free(hot);
+  return 0;
+}
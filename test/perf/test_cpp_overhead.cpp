@@ -0,0 +1,75 @@
+#include "cbuf.hpp"
+#include "cbuf_timeout.h"
+#include "test_utils.h"
+
+#include <chrono>
+
+/**
+ * Compare the cost of the same single-threaded write/read round trips through
+ * the C API and through the C++ wrapper. The wrapper is expected to compile
+ * down to the same calls, so the two columns should be within noise.
+ */
+
+struct record {
+  uint64_t seq;
+  uint64_t payload[7];
+};
+
+static constexpr size_t ITERS = 2000000;
+
+template <class F> static double ns_per_op(F &&f) {
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < ITERS; i++)
+    f(i);
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / ITERS;
+}
+
+int main() {
+  cbuf_t c;
+  cbuf::ring r(65536);
+  record rec{}, out{};
+  uint64_t sink = 0;
+
+  TEST_ASSERT(cbuf_init(&c, 65536) == 0, "Failed to initialize buffer");
+
+  double c_rw = ns_per_op([&](size_t i) {
+    rec.seq = i;
+    cbuf_write_blocking(&c, (const uint8_t *)&rec, sizeof(rec), -1);
+    cbuf_read_blocking(&c, (uint8_t *)&out, sizeof(out), -1, true);
+    sink += out.seq;
+  });
+
+  double cpp_rw = ns_per_op([&](size_t i) {
+    rec.seq = i;
+    r.push(rec);
+    r.pop(out);
+    sink += out.seq;
+  });
+
+  double c_segs = ns_per_op([&](size_t i) {
+    cbuf_segs_t segs;
+    cbuf_get_write_segs(&c, &segs);
+    segs.ptr[0][0] = i & 0xFF;
+    cbuf_commit(&c, 1);
+    cbuf_get_read_segs(&c, &segs);
+    sink += segs.ptr[0][0];
+    cbuf_remove(&c, 1);
+  });
+
+  double cpp_views = ns_per_op([&](size_t i) {
+    r.write_view().first()[0] = i & 0xFF;
+    r.commit(1);
+    sink += r.read_view().first()[0];
+    r.consume(1);
+  });
+
+  printf("%-28s %10s %10s\n", "operation", "C (ns)", "C++ (ns)");
+  printf("%-28s %10.1f %10.1f\n", "64B write + read", c_rw, cpp_rw);
+  printf("%-28s %10.1f %10.1f\n", "1B zero-copy commit/consume", c_segs,
+         cpp_views);
+  printf("(checksum %llu)\n", (unsigned long long)sink);
+
+  cbuf_free(&c);
+  return 0;
+}
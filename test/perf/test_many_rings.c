@@ -0,0 +1,219 @@
+#include "cbuf_pool.h"
+#include "cbuf_timeout.h"
+#include "test_utils.h"
+
+#include <sys/wait.h>
+
+/**
+ * Many-rings benchmark: one small ring per "connection", with sparse traffic,
+ * for ring counts from 1 to 100k, with rings from `cbuf_init()` (one heap
+ * allocation each) and from a `cbuf_pool_t` (one slab). Each measurement
+ * runs in a fresh child process, so that memory freed by an earlier one is
+ * not reused and does not hide the cost of the rings. Reports
+ *
+ * - resident memory per ring, once each ring has carried a message,
+ *
+ * - the cost per ring of a polling scan with `cbuf_is_empty()` and with
+ *   `cbuf_get_readable_size()` over rings that are all empty,
+ *
+ * - end-to-end latency of a message written into a random ring while a
+ *   consumer thread scans all of them.
+ */
+
+#define RING_CAPACITY CBUF_MIN_CAPACITY
+#define MAX_RINGS 100000U
+/* Scan at least this many ring checks per measurement */
+#define SCAN_CHECKS 2000000U
+/* Messages per latency measurement; fewer for huge ring counts */
+#define MAX_MSGS 500U
+
+typedef struct {
+  cbuf_t **rings;
+  size_t nrings;
+  size_t nmsgs;
+  _Atomic(size_t) received;
+  int64_t *lat;
+} latency_arg_t;
+
+static long page_size;
+
+/* Resident set size in bytes */
+static size_t rss_bytes(void) {
+  unsigned long size = 0, resident = 0;
+  FILE *f = fopen("/proc/self/statm", "r");
+
+  if (!f)
+    return 0;
+  if (fscanf(f, "%lu %lu", &size, &resident) != 2)
+    resident = 0;
+  fclose(f);
+  return resident * (size_t)page_size;
+}
+
+static int cmp_i64(const void *a, const void *b) {
+  int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+  return (x > y) - (x < y);
+}
+
+static void *latency_producer(void *arg) {
+  latency_arg_t *p = (latency_arg_t *)arg;
+  uint32_t seed = 12345;
+  int64_t ts;
+
+  for (size_t m = 0; m < p->nmsgs; m++) {
+    seed = seed * 1103515245U + 12345U;
+    ts = cbuf_time_now_nsec();
+    TEST_ASSERT(cbuf_write_blocking(p->rings[(seed >> 8) % p->nrings],
+                                    (uint8_t *)&ts, sizeof(ts),
+                                    -1) == sizeof(ts),
+                "Write failed");
+    /* Sparse traffic: one message in flight at a time */
+    while (atomic_load_explicit(&p->received, memory_order_acquire) <= m)
+      spin_yield();
+  }
+  return NULL;
+}
+
+/* Run all measurements; prints nothing if @p layout is NULL */
+static void run(const char *layout, cbuf_t **rings, size_t n, size_t rss0) {
+  latency_arg_t arg;
+  pthread_t producer;
+  size_t rss, scans, i, s;
+  int64_t begin, t_empty, t_size, ts, sink = 0;
+  uint64_t msg;
+
+  /* Every ring carries one message, as every connection would */
+  for (i = 0; i < n; i++) {
+    msg = i;
+    TEST_ASSERT(cbuf_write_blocking(rings[i], (uint8_t *)&msg, sizeof(msg),
+                                    0) == sizeof(msg),
+                "Write failed");
+    TEST_ASSERT(cbuf_read_blocking(rings[i], (uint8_t *)&msg, sizeof(msg), 0,
+                                   true) == sizeof(msg),
+                "Read failed");
+    TEST_ASSERT(msg == i, "Wrong message");
+  }
+  rss = rss_bytes();
+
+  scans = MAX(SCAN_CHECKS / n, (size_t)1);
+  begin = cbuf_time_now_nsec();
+  for (s = 0; s < scans; s++)
+    for (i = 0; i < n; i++)
+      sink += cbuf_is_empty(rings[i]);
+  t_empty = cbuf_time_now_nsec() - begin;
+  /* Keep the scans from being optimized out */
+  __asm__ volatile("" : : "r"(sink));
+
+  begin = cbuf_time_now_nsec();
+  for (s = 0; s < scans; s++)
+    for (i = 0; i < n; i++)
+      sink += cbuf_get_readable_size(rings[i]);
+  t_size = cbuf_time_now_nsec() - begin;
+  __asm__ volatile("" : : "r"(sink));
+
+  arg.rings = rings;
+  arg.nrings = n;
+  arg.nmsgs = MIN((size_t)MAX_MSGS, MAX((size_t)20, 20000000 / n / 100));
+  atomic_init(&arg.received, 0);
+  arg.lat = malloc(arg.nmsgs * sizeof(*arg.lat));
+  TEST_ASSERT(arg.lat, "Allocation failed");
+
+  pthread_create(&producer, NULL, latency_producer, &arg);
+  for (size_t m = 0, found; m < arg.nmsgs;) {
+    found = 0;
+    for (i = 0; i < n; i++) {
+      if (cbuf_is_empty(rings[i]))
+        continue;
+      TEST_ASSERT(cbuf_read_blocking(rings[i], (uint8_t *)&ts, sizeof(ts), 0,
+                                     true) == sizeof(ts),
+                  "Read failed");
+      arg.lat[m++] = cbuf_time_now_nsec() - ts;
+      atomic_store_explicit(&arg.received, m, memory_order_release);
+      found++;
+    }
+    /* Let the producer run if it shares our processor */
+    if (!found)
+      spin_yield();
+  }
+  pthread_join(producer, NULL);
+  qsort(arg.lat, arg.nmsgs, sizeof(*arg.lat), cmp_i64);
+
+  if (layout)
+    printf("%-7s %7zu %10.0f %12.2f %12.2f %11.1f %11.1f\n", layout, n,
+           (double)(rss - rss0) / n, (double)t_empty / (scans * n),
+           (double)t_size / (scans * n), arg.lat[arg.nmsgs / 2] / 1000.0,
+           arg.lat[arg.nmsgs * 99 / 100] / 1000.0);
+
+  free(arg.lat);
+}
+
+/* Measure @p n rings of @p layout in a fresh child process */
+static void measure(const char *layout, size_t n) {
+  cbuf_t **rings;
+  cbuf_pool_t pool;
+  size_t rss0, i;
+  pid_t pid;
+  int status;
+
+  fflush(stdout);
+  pid = fork();
+  TEST_ASSERT(pid >= 0, "fork failed");
+  if (pid) {
+    TEST_ASSERT(waitpid(pid, &status, 0) == pid, "waitpid failed");
+    if (WIFSIGNALED(status))
+      fprintf(stderr, "%s/%zu: killed by signal %d\n", layout, n,
+              WTERMSIG(status));
+    TEST_ASSERT(WIFEXITED(status) && (WEXITSTATUS(status) == 0),
+                "Measurement failed");
+    return;
+  }
+
+  /* The ring table is the caller's; fault it in before measuring */
+  rings = malloc(n * sizeof(*rings));
+  TEST_ASSERT(rings, "Allocation failed");
+  memset(rings, 0xff, n * sizeof(*rings)); /* not 0: may become calloc() */
+
+  /* Warm up the heap and thread creation before measuring RSS */
+  rings[0] = aligned_alloc(CACHELINE_SIZE, sizeof(cbuf_t));
+  TEST_ASSERT(rings[0] && (cbuf_init(rings[0], RING_CAPACITY) == 0),
+              "Init failed");
+  run(NULL, rings, 1, 0);
+  cbuf_free(rings[0]);
+  free(rings[0]);
+
+  rss0 = rss_bytes();
+  if (!strcmp(layout, "pool")) {
+    TEST_ASSERT(cbuf_pool_init(&pool, RING_CAPACITY, n, 0) == 0,
+                "Pool init failed");
+    for (i = 0; i < n; i++)
+      TEST_ASSERT((rings[i] = cbuf_pool_get(&pool)) != NULL, "Get failed");
+  } else {
+    for (i = 0; i < n; i++) {
+      rings[i] = aligned_alloc(CACHELINE_SIZE, sizeof(cbuf_t));
+      TEST_ASSERT(rings[i] && (cbuf_init(rings[i], RING_CAPACITY) == 0),
+                  "Init failed");
+    }
+  }
+  run(layout, rings, n, rss0);
+  fflush(stdout);
+  _exit(0);
+}
+
+int main() {
+  static const size_t counts[] = {1, 10, 100, 1000, 10000, MAX_RINGS};
+
+  page_size = sysconf(_SC_PAGESIZE);
+
+  printf("%zu B rings, sizeof(cbuf_t) = %zu B\n", (size_t)RING_CAPACITY,
+         sizeof(cbuf_t));
+  printf("%-7s %7s %10s %12s %12s %11s %11s\n", "layout", "rings",
+         "RSS B/ring", "empty ns/rng", "size ns/rng", "p50 lat us",
+         "p99 lat us");
+
+  for (size_t c = 0; c < ARR_COUNT(counts); c++) {
+    measure("malloc", counts[c]);
+    measure("pool", counts[c]);
+  }
+
+  return 0;
+}
@@ -0,0 +1,142 @@
+#include "cbuf_zblock.h"
+#include "cbuf_timeout.h"
+#include "test_utils.h"
+
+/**
+ * Compressed block benchmark: stream log-like text through a ring with plain
+ * `cbuf_write_blocking()` and with a `cbuf_zwriter_t`, and report
+ *
+ * - end-to-end throughput of uncompressed data,
+ *
+ * - the bytes that actually went through the ring,
+ *
+ * - compression ratio and time per block on both sides.
+ */
+
+#define RING_SIZE (1U << 20)
+#define TOTAL_SIZE (64U << 20)
+#define CHUNK_SIZE 4000U
+#define BLOCK_SIZE (64U << 10)
+
+static const char *paths[] = {"/api/v1/items", "/api/v1/users",
+                              "/api/v1/orders", "/healthz"};
+
+typedef struct {
+  cbuf_t *cbuf;
+  const uint8_t *text;
+  size_t text_size;
+  bool compressed;
+  cbuf_zstats_t stats;
+} producer_arg_t;
+
+static void make_text(uint8_t *buf, size_t n) {
+  char line[128];
+  size_t i = 0, len;
+  uint32_t seed = 1;
+
+  while (i < n) {
+    seed = seed * 1103515245U + 12345U;
+    len = (size_t)snprintf(
+        line, sizeof(line),
+        "2024-05-01T12:00:%02u INFO %s %s/%u status=%u latency_ms=%u\n",
+        (seed >> 8) % 60, (seed & 0x100) ? "GET" : "POST",
+        paths[(seed >> 16) % 4], (seed >> 20) % 1000,
+        (seed & 0x1000) ? 200 : 404, (seed >> 24) % 100);
+    len = MIN(len, n - i);
+    memcpy(buf + i, line, len);
+    i += len;
+  }
+}
+
+static void *producer(void *arg) {
+  producer_arg_t *p = (producer_arg_t *)arg;
+  cbuf_zwriter_t w;
+  size_t off = 0, n;
+
+  if (p->compressed)
+    TEST_ASSERT(cbuf_zwriter_init(&w, p->cbuf, BLOCK_SIZE) == 0,
+                "Init failed");
+
+  for (size_t total = 0; total < TOTAL_SIZE; total += n) {
+    n = MIN(CHUNK_SIZE, p->text_size - off);
+    if (p->compressed)
+      TEST_ASSERT(cbuf_zwrite(&w, p->text + off, n, -1) == (ssize_t)n,
+                  "Write failed");
+    else
+      TEST_ASSERT(cbuf_write_blocking(p->cbuf, p->text + off, n, -1) ==
+                      (ssize_t)n,
+                  "Write failed");
+    off = (off + n) % p->text_size;
+  }
+
+  if (p->compressed) {
+    TEST_ASSERT(cbuf_zflush(&w, -1) == 1, "Flush failed");
+    p->stats = w.stats;
+    cbuf_zwriter_free(&w);
+  }
+  return NULL;
+}
+
+static void run(const char *name, const uint8_t *text, size_t text_size,
+                bool compressed) {
+  cbuf_t cbuf;
+  cbuf_zreader_t r;
+  pthread_t thread;
+  producer_arg_t arg;
+  static uint8_t buf[BLOCK_SIZE];
+  uint64_t total = 0;
+  int64_t begin, elapsed;
+  ssize_t n;
+
+  TEST_ASSERT(cbuf_init(&cbuf, RING_SIZE) == 0, "Init failed");
+  if (compressed)
+    TEST_ASSERT(cbuf_zreader_init(&r, &cbuf, BLOCK_SIZE) == 0, "Init failed");
+
+  arg = (producer_arg_t){&cbuf, text, text_size, compressed, {0}};
+  begin = cbuf_time_now_nsec();
+  pthread_create(&thread, NULL, producer, &arg);
+  while (total < TOTAL_SIZE) {
+    if (compressed)
+      n = cbuf_zread(&r, buf, sizeof(buf), 5000);
+    else
+      n = cbuf_read_blocking(&cbuf, buf, sizeof(buf), 5000, false);
+    TEST_ASSERT(n > 0, "Read failed");
+    total += n;
+  }
+  pthread_join(thread, NULL);
+  elapsed = cbuf_time_now_nsec() - begin;
+
+  if (compressed) {
+    printf("%-10s %10.2f %12.1f %8.2f %12.1f %12.1f\n", name,
+           (double)total / elapsed, (double)arg.stats.z_bytes / (1U << 20),
+           cbuf_zstats_ratio(&arg.stats),
+           (double)arg.stats.nsec / arg.stats.blocks / 1000.0,
+           (double)r.stats.nsec / r.stats.blocks / 1000.0);
+    cbuf_zreader_free(&r);
+  } else {
+    printf("%-10s %10.2f %12.1f %8.2f %12s %12s\n", name,
+           (double)total / elapsed, (double)total / (1U << 20), 1.0, "-",
+           "-");
+  }
+
+  cbuf_free(&cbuf);
+}
+
+int main() {
+  size_t text_size = 8U << 20;
+  uint8_t *text = malloc(text_size);
+
+  TEST_ASSERT(text, "Allocation failed");
+  make_text(text, text_size);
+
+  printf("%u MiB of log text, %u KiB ring, %u KiB blocks\n", TOTAL_SIZE >> 20,
+         RING_SIZE >> 10, BLOCK_SIZE >> 10);
+  printf("%-10s %10s %12s %8s %12s %12s\n", "mode", "GB/s", "ring MiB",
+         "ratio", "comp us/blk", "dec us/blk");
+
+  run("plain", text, text_size, false);
+  run("zblock", text, text_size, true);
+
+  free(text);
+  return 0;
+}
@@ -0,0 +1,198 @@
+#include "cbuf_group.h"
+#include "cbuf_prio.h"
+#include "cbuf_stamp.h"
+#include "test_utils.h"
+
+#define NUM_MSGS 10
+#define GAP_USEC 20000
+
+void *slow_producer(void *arg) {
+  cbuf_t *cbuf = (cbuf_t *)arg;
+
+  for (uint32_t i = 0; i < NUM_MSGS; i++) {
+    usleep(GAP_USEC);
+    TEST_ASSERT(cbuf_write_blocking(cbuf, (uint8_t *)&i, sizeof(i), -1) ==
+                    sizeof(i),
+                "Write failed");
+  }
+  return NULL;
+}
+
+void test_adaptive_decisions() {
+  cbuf_t cbuf;
+  cbuf_wait_stats_t stats;
+  uint8_t buf[600];
+
+  TEST_ASSERT(cbuf_init(&cbuf, CBUF_MIN_CAPACITY) == 0, "Init failed");
+
+  TEST_ASSERT(cbuf_set_adaptive_wait(NULL, true, 0) == -1,
+              "NULL cbuf must fail");
+  TEST_ASSERT(cbuf_set_adaptive_wait(&cbuf, true, -1) == -1,
+              "Negative park cost must fail");
+  TEST_ASSERT(cbuf_get_wait_stats(&cbuf, (cbuf_side_t)2, &stats) == -1,
+              "Bad side must fail");
+
+  /* Disabled: waits are not tracked */
+  TEST_ASSERT(cbuf_read_blocking(&cbuf, buf, 1, 2, false) == 0,
+              "Empty cbuf must time out");
+  cbuf_get_wait_stats(&cbuf, CBUF_READER, &stats);
+  TEST_ASSERT(stats.ewma_nsec == 0 && stats.waits[CBUF_WAIT_SPIN] == 0,
+              "Waits must not be tracked while disabled");
+
+  TEST_ASSERT(cbuf_set_adaptive_wait(&cbuf, true, 0) == 0, "Enable failed");
+  TEST_ASSERT(cbuf.park_nsec == CBUF_WAIT_PARK_NSEC, "Wrong default cost");
+
+  /* Calls that do not wait are not waits */
+  TEST_ASSERT(cbuf_read_blocking(&cbuf, buf, 1, 0, false) == 0,
+              "Empty cbuf must time out");
+  cbuf_write_blocking(&cbuf, buf, 10, 0);
+  cbuf_read_blocking(&cbuf, buf, 10, -1, true);
+  cbuf_get_wait_stats(&cbuf, CBUF_READER, &stats);
+  TEST_ASSERT(stats.waits[CBUF_WAIT_SPIN] == 0 && stats.ewma_nsec == 0,
+              "Calls that did not wait must not count");
+
+  /* Nothing known yet: spin, then learn that waits are long */
+  TEST_ASSERT(cbuf_read_blocking(&cbuf, buf, 1, 5, false) == 0,
+              "Empty cbuf must time out");
+  cbuf_get_wait_stats(&cbuf, CBUF_READER, &stats);
+  TEST_ASSERT(stats.waits[CBUF_WAIT_SPIN] == 1 &&
+                  stats.last == CBUF_WAIT_SPIN,
+              "First wait must spin");
+  TEST_ASSERT(stats.ewma_nsec >= 4000000, "Wait must be learned");
+
+  /* A 5 ms expected wait is far above 20x the park cost: sleep */
+  TEST_ASSERT(cbuf_waitfor_readable(&cbuf, 1, 5) == 0,
+              "Empty cbuf must time out");
+  cbuf_get_wait_stats(&cbuf, CBUF_READER, &stats);
+  TEST_ASSERT(stats.waits[CBUF_WAIT_SLEEP] == 1 &&
+                  stats.last == CBUF_WAIT_SLEEP,
+              "Long expected wait must sleep");
+
+  /* With a 1 ms park cost, the same wait is worth yielding for */
+  TEST_ASSERT(cbuf_set_adaptive_wait(&cbuf, true, 1000000) == 0,
+              "Enable failed");
+  cbuf_get_wait_stats(&cbuf, CBUF_READER, &stats);
+  TEST_ASSERT(stats.ewma_nsec == 0, "Enabling must reset the stats");
+  cbuf_read_blocking(&cbuf, buf, 1, 5, false);
+  cbuf_read_blocking(&cbuf, buf, 1, 5, false);
+  cbuf_get_wait_stats(&cbuf, CBUF_READER, &stats);
+  TEST_ASSERT(stats.waits[CBUF_WAIT_SPIN] == 1 &&
+                  stats.waits[CBUF_WAIT_YIELD] == 1 &&
+                  stats.last == CBUF_WAIT_YIELD,
+              "Medium expected wait must yield");
+
+  /* The writer side is tracked separately */
+  cbuf_write_blocking(&cbuf, buf, cbuf_get_capacity(&cbuf), 0);
+  TEST_ASSERT(cbuf_write_blocking(&cbuf, buf, 1, 3) == 0,
+              "Full cbuf must time out");
+  cbuf_get_wait_stats(&cbuf, CBUF_WRITER, &stats);
+  TEST_ASSERT(stats.waits[CBUF_WAIT_SPIN] == 1 && stats.ewma_nsec > 0,
+              "Writer wait must be tracked");
+  cbuf_get_wait_stats(&cbuf, CBUF_READER, &stats);
+  TEST_ASSERT(stats.waits[CBUF_WAIT_SPIN] == 1 &&
+                  stats.waits[CBUF_WAIT_YIELD] == 1,
+              "Reader stats must be untouched");
+
+  TEST_ASSERT(cbuf_set_adaptive_wait(&cbuf, false, 0) == 0, "Disable failed");
+  TEST_ASSERT(!(cbuf.flags & CBUF_F_ADAPTIVE), "Flag must be cleared");
+
+  cbuf_free(&cbuf);
+}
+
+void test_adaptive_threaded() {
+  cbuf_t cbuf;
+  cbuf_wait_stats_t stats;
+  pthread_t producer;
+  uint32_t v;
+
+  TEST_ASSERT(cbuf_init(&cbuf, CBUF_MIN_CAPACITY) == 0, "Init failed");
+  TEST_ASSERT(cbuf_set_adaptive_wait(&cbuf, true, 0) == 0, "Enable failed");
+
+  pthread_create(&producer, NULL, slow_producer, &cbuf);
+  for (uint32_t i = 0; i < NUM_MSGS; i++) {
+    TEST_ASSERT(cbuf_read_blocking(&cbuf, (uint8_t *)&v, sizeof(v), -1,
+                                   true) == sizeof(v),
+                "Read failed");
+    TEST_ASSERT(v == i, "Out of order data");
+  }
+  pthread_join(producer, NULL);
+
+  /* Only the first wait had no history; the rest slept */
+  cbuf_get_wait_stats(&cbuf, CBUF_READER, &stats);
+  TEST_ASSERT(stats.waits[CBUF_WAIT_SPIN] == 1, "Only one wait may spin");
+  TEST_ASSERT(stats.waits[CBUF_WAIT_SLEEP] >= NUM_MSGS - 2,
+              "Waits on a slow producer must sleep");
+  TEST_ASSERT(stats.ewma_nsec > GAP_USEC * 1000 / 2, "Wrong expected wait");
+
+  cbuf_free(&cbuf);
+}
+
+void test_adaptive_extensions() {
+  cbuf_t cbuf;
+  cbuf_group_t group;
+  cbuf_prio_t prio;
+  cbuf_stamp_reader_t reader;
+  cbuf_wait_stats_t stats;
+  uint64_t ready;
+  uint8_t buf[64];
+
+  /* Stamped reads wait on the reader side of their cbuf */
+  TEST_ASSERT(cbuf_init(&cbuf, CBUF_MIN_CAPACITY) == 0, "Init failed");
+  TEST_ASSERT(cbuf_set_adaptive_wait(&cbuf, true, 0) == 0, "Enable failed");
+  TEST_ASSERT(cbuf_stamp_reader_init(&reader, 0) == 0, "Reader init failed");
+  TEST_ASSERT(cbuf_stamp_read(&cbuf, &reader, buf, sizeof(buf), 3) == 0,
+              "Empty cbuf must time out");
+  cbuf_get_wait_stats(&cbuf, CBUF_READER, &stats);
+  TEST_ASSERT(stats.waits[CBUF_WAIT_SPIN] == 1 && stats.ewma_nsec > 0,
+              "Stamped read must wait adaptively");
+
+  /* Group waits have their own statistics */
+  TEST_ASSERT(cbuf_group_init(&group) == 0, "Group init failed");
+  TEST_ASSERT(cbuf_group_add(&group, &cbuf) == 0, "Add failed");
+  TEST_ASSERT(cbuf_group_set_adaptive_wait(&group, true, -1) == -1,
+              "Negative park cost must fail");
+  TEST_ASSERT(cbuf_group_wait(&group, &ready, 3) == 0,
+              "Empty group must time out");
+  cbuf_group_get_wait_stats(&group, &stats);
+  TEST_ASSERT(stats.ewma_nsec == 0, "Waits must not be tracked while disabled");
+  TEST_ASSERT(cbuf_group_set_adaptive_wait(&group, true, 0) == 0,
+              "Enable failed");
+  TEST_ASSERT(cbuf_group_wait(&group, &ready, 3) == 0,
+              "Empty group must time out");
+  TEST_ASSERT(cbuf_group_wait(&group, &ready, 3) == 0,
+              "Empty group must time out");
+  cbuf_group_get_wait_stats(&group, &stats);
+  TEST_ASSERT(stats.waits[CBUF_WAIT_SPIN] == 1 &&
+                  stats.waits[CBUF_WAIT_SLEEP] == 1,
+              "Group wait must learn from its history");
+  cbuf_group_remove(&group, &cbuf);
+  cbuf_free(&cbuf);
+
+  /* Priority reads follow the bulk lane */
+  TEST_ASSERT(cbuf_prio_init(&prio, CBUF_MIN_CAPACITY, CBUF_MIN_CAPACITY) == 0,
+              "Prio init failed");
+  TEST_ASSERT(cbuf_set_adaptive_wait(&prio.bulk, true, 0) == 0,
+              "Enable failed");
+  TEST_ASSERT(cbuf_prio_read(&prio, buf, sizeof(buf), 3, NULL) == 0,
+              "Empty lanes must time out");
+  cbuf_get_wait_stats(&prio.bulk, CBUF_READER, &stats);
+  TEST_ASSERT(stats.waits[CBUF_WAIT_SPIN] == 1 && stats.ewma_nsec > 0,
+              "Priority read must wait adaptively");
+  cbuf_prio_free(&prio);
+}
+
+int main() {
+  printf("Running adaptive wait tests...\n");
+
+  test_adaptive_decisions();
+  printf("\x1B[92m  ✓ wait mode decision tests passed\x1B[0m\n");
+
+  test_adaptive_threaded();
+  printf("\x1B[92m  ✓ slow producer test passed\x1B[0m\n");
+
+  test_adaptive_extensions();
+  printf("\x1B[92m  ✓ extension wait tests passed\x1B[0m\n");
+
+  printf("All adaptive wait tests passed!\n");
+  return 0;
+}
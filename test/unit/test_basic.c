@@ -127,6 +127,178 @@ void test_peek_and_remove() {
   cbuf_free(&cbuf);
 }
 
+void test_peek_at_and_view_at() {
+  cbuf_t cbuf;
+  cbuf_segs_t segs;
+  uint8_t data[CBUF_MIN_CAPACITY], out[64];
+
+  TEST_ASSERT(cbuf_init(&cbuf, CBUF_MIN_CAPACITY) == 0,
+              "Initialization failed");
+  for (int i = 0; i < CBUF_MIN_CAPACITY; i++)
+    data[i] = i & 0xFF;
+
+  TEST_ASSERT(cbuf_peek_at(NULL, 0, out, 1) == -1, "NULL cbuf must fail");
+  TEST_ASSERT(cbuf_peek_at(&cbuf, 0, NULL, 1) == -1, "NULL buf must fail");
+  TEST_ASSERT(cbuf_view_at(&cbuf, 0, 1, NULL) == -1, "NULL segs must fail");
+  TEST_ASSERT(cbuf_peek_at(&cbuf, 0, out, 1) == 0, "Empty cbuf");
+
+  /* Move the read position close to the end so the data wraps */
+  TEST_ASSERT(cbuf_write_blocking(&cbuf, data, 480, -1) == 480, "Write failed");
+  TEST_ASSERT(cbuf_remove(&cbuf, 480) == 480, "Remove failed");
+  TEST_ASSERT(cbuf_write_blocking(&cbuf, data, 100, -1) == 100, "Write failed");
+
+  /* Contiguous, before the wrap */
+  TEST_ASSERT(cbuf_peek_at(&cbuf, 10, out, 8) == 8, "Peek at failed");
+  for (int i = 0; i < 8; i++)
+    TEST_ASSERT(out[i] == 10 + i, "Peek at data mismatch");
+  TEST_ASSERT(cbuf_view_at(&cbuf, 10, 8, &segs) == 8, "View at failed");
+  TEST_ASSERT(segs.len[0] == 8 && segs.len[1] == 0 && segs.ptr[0][0] == 10,
+              "View at before the wrap must be one segment");
+
+  /* Straddling the wrap */
+  TEST_ASSERT(cbuf_peek_at(&cbuf, 28, out, 8) == 8, "Peek at failed");
+  for (int i = 0; i < 8; i++)
+    TEST_ASSERT(out[i] == 28 + i, "Peek at across the wrap mismatch");
+  TEST_ASSERT(cbuf_view_at(&cbuf, 28, 8, &segs) == 8, "View at failed");
+  TEST_ASSERT(segs.len[0] == 4 && segs.len[1] == 4 && segs.ptr[1][0] == 32,
+              "View at across the wrap must be two segments");
+
+  /* Entirely after the wrap */
+  TEST_ASSERT(cbuf_view_at(&cbuf, 40, 8, &segs) == 8, "View at failed");
+  TEST_ASSERT(segs.len[0] == 8 && segs.len[1] == 0 && segs.ptr[0][0] == 40,
+              "View at after the wrap must be one segment");
+
+  /* Bounds are clamped to the readable data */
+  TEST_ASSERT(cbuf_peek_at(&cbuf, 96, out, 8) == 4, "Peek at must clamp");
+  TEST_ASSERT(out[3] == 99, "Peek at clamped data mismatch");
+  TEST_ASSERT(cbuf_peek_at(&cbuf, 100, out, 8) == 0,
+              "Peek at past the readable data must be empty");
+  TEST_ASSERT(cbuf_view_at(&cbuf, 1000, 8, &segs) == 0,
+              "View at past the readable data must be empty");
+
+  TEST_ASSERT(cbuf_get_readable_size(&cbuf) == 100,
+              "Peek at and view at must not consume data");
+
+  cbuf_free(&cbuf);
+}
+
+void test_find_and_read_until() {
+  cbuf_t cbuf;
+  uint8_t filler[500], line[64];
+  const char *text = "first\r\nsecond line\r\nthird";
+
+  TEST_ASSERT(cbuf_init(&cbuf, CBUF_MIN_CAPACITY) == 0,
+              "Initialization failed");
+
+  /* Move the read position close to the end so that the text wraps */
+  memset(filler, 'x', sizeof(filler));
+  TEST_ASSERT(cbuf_write_blocking(&cbuf, filler, sizeof(filler), -1) == 500,
+              "Failed to write filler");
+  TEST_ASSERT(cbuf_remove(&cbuf, 500) == 500, "Failed to remove filler");
+
+  TEST_ASSERT(cbuf_find(&cbuf, (const uint8_t *)"\n", 1) == -1,
+              "Find in empty buffer must fail");
+
+  TEST_ASSERT(cbuf_write_blocking(&cbuf, (const uint8_t *)text, strlen(text),
+                                  -1) == (ssize_t)strlen(text),
+              "Failed to write text");
+
+  /* Single byte and multi-byte patterns, including across the wrap */
+  TEST_ASSERT(cbuf_find(&cbuf, (const uint8_t *)"\n", 1) == 6,
+              "Byte search returned the wrong offset");
+  TEST_ASSERT(cbuf_find(&cbuf, (const uint8_t *)"\r\n", 2) == 5,
+              "Pattern search returned the wrong offset");
+  TEST_ASSERT(cbuf_find(&cbuf, (const uint8_t *)"cond line", 9) == 9,
+              "Pattern straddling the wrap not found");
+  TEST_ASSERT(cbuf_find(&cbuf, (const uint8_t *)"\r\nthird", 7) == 18,
+              "Pattern after the wrap not found");
+  TEST_ASSERT(cbuf_find(&cbuf, (const uint8_t *)"fourth", 6) == -1,
+              "Missing pattern must not be found");
+  TEST_ASSERT(cbuf_get_readable_size(&cbuf) == (ssize_t)strlen(text),
+              "Find must not consume data");
+
+  TEST_ASSERT(cbuf_read_until(&cbuf, line, sizeof(line),
+                              (const uint8_t *)"\r\n", 2, 0) == 7,
+              "Failed to read the first line");
+  TEST_ASSERT(!memcmp(line, "first\r\n", 7), "First line mismatch");
+  TEST_ASSERT(cbuf_read_until(&cbuf, line, sizeof(line),
+                              (const uint8_t *)"\r\n", 2, 0) == 13,
+              "Failed to read the second line");
+  TEST_ASSERT(!memcmp(line, "second line\r\n", 13), "Second line mismatch");
+
+  /* Incomplete record: times out without consuming anything */
+  TEST_ASSERT(cbuf_read_until(&cbuf, line, sizeof(line),
+                              (const uint8_t *)"\r\n", 2, 10) == 0,
+              "Incomplete record must time out");
+  TEST_ASSERT(cbuf_get_readable_size(&cbuf) == 5,
+              "Timed out read must not consume data");
+
+  /* Record longer than the destination buffer */
+  TEST_ASSERT(cbuf_read_until(&cbuf, line, 4, (const uint8_t *)"\r\n", 2,
+                              0) == -1,
+              "Record larger than buf must fail");
+
+  cbuf_free(&cbuf);
+}
+
+void test_splice() {
+  cbuf_t src, dst;
+  uint8_t data[100], out[100], fill[CBUF_MIN_CAPACITY];
+  size_t src_offs[] = {0, 450, 500}, dst_offs[] = {0, 430, 490, 505};
+
+  for (int i = 0; i < 100; i++)
+    data[i] = i + 1;
+  memset(fill, 0, sizeof(fill));
+
+  TEST_ASSERT(cbuf_init(&src, CBUF_MIN_CAPACITY) == 0, "Init failed");
+  TEST_ASSERT(cbuf_init(&dst, CBUF_MIN_CAPACITY) == 0, "Init failed");
+
+  TEST_ASSERT(cbuf_splice(&dst, &dst, 1, 0) == -1, "Self splice must fail");
+  TEST_ASSERT(cbuf_splice(NULL, &src, 1, 0) == -1, "NULL dst must fail");
+  TEST_ASSERT(cbuf_splice(&dst, &src, 1, 0) == 0, "Empty src must time out");
+  TEST_ASSERT(cbuf_splice(&dst, &src, 1, 10) == 0, "Empty src must time out");
+  cbuf_free(&src);
+  cbuf_free(&dst);
+
+  /* Every combination of wrapping and non-wrapping source and destination */
+  for (size_t i = 0; i < ARR_COUNT(src_offs); i++) {
+    for (size_t j = 0; j < ARR_COUNT(dst_offs); j++) {
+      TEST_ASSERT(cbuf_init(&src, CBUF_MIN_CAPACITY) == 0, "Init failed");
+      TEST_ASSERT(cbuf_init(&dst, CBUF_MIN_CAPACITY) == 0, "Init failed");
+      cbuf_write_blocking(&src, fill, src_offs[i], 0);
+      cbuf_remove(&src, src_offs[i]);
+      cbuf_write_blocking(&dst, fill, dst_offs[j], 0);
+      cbuf_remove(&dst, dst_offs[j]);
+
+      TEST_ASSERT(cbuf_write_blocking(&src, data, 100, 0) == 100,
+                  "Write failed");
+      TEST_ASSERT(cbuf_splice(&dst, &src, 60, 0) == 60, "Splice failed");
+      TEST_ASSERT(cbuf_splice(&dst, &src, 1000, 0) == 40,
+                  "Splice must move what is readable");
+      TEST_ASSERT(cbuf_is_empty(&src) == 1, "Spliced data must be consumed");
+      TEST_ASSERT(cbuf_read_blocking(&dst, out, 100, 0, true) == 100,
+                  "Read failed");
+      TEST_ASSERT(memcmp(out, data, 100) == 0, "Spliced data mismatch");
+
+      cbuf_free(&src);
+      cbuf_free(&dst);
+    }
+  }
+
+  /* Limited by the free space in dst */
+  TEST_ASSERT(cbuf_init(&src, CBUF_MIN_CAPACITY) == 0, "Init failed");
+  TEST_ASSERT(cbuf_init(&dst, CBUF_MIN_CAPACITY) == 0, "Init failed");
+  cbuf_write_blocking(&dst, fill, CBUF_MIN_CAPACITY - 11, 0);
+  cbuf_write_blocking(&src, data, 100, 0);
+  TEST_ASSERT(cbuf_splice(&dst, &src, 100, 0) == 10,
+              "Splice must move what fits");
+  TEST_ASSERT(cbuf_get_readable_size(&src) == 90, "Wrong remainder in src");
+  TEST_ASSERT(cbuf_splice(&dst, &src, 100, 10) == 0, "Full dst must time out");
+
+  cbuf_free(&src);
+  cbuf_free(&dst);
+}
+
 int main() {
   printf("Running basic tests...\n");
 
@@ -142,6 +314,15 @@ int main() {
   test_peek_and_remove();
   printf("\x1B[92m  ✓ peek/remove tests passed\x1B[0m\n");
 
+  test_peek_at_and_view_at();
+  printf("\x1B[92m  ✓ peek_at/view_at tests passed\x1B[0m\n");
+
+  test_find_and_read_until();
+  printf("\x1B[92m  ✓ find/read_until tests passed\x1B[0m\n");
+
+  test_splice();
+  printf("\x1B[92m  ✓ splice tests passed\x1B[0m\n");
+
   printf("All basic tests passed!\n");
   return 0;
 }
@@ -0,0 +1,141 @@
+#include "test_utils.h"
+
+#define NUM_MSGS 100000
+#define MSG_SIZE 24
+
+void *batch_producer(void *arg) {
+  cbuf_t *cbuf = (cbuf_t *)arg;
+  uint8_t msg[MSG_SIZE];
+
+  TEST_ASSERT(cbuf_set_batching(cbuf, 256, 100) == 0, "Set batching failed");
+  for (uint32_t i = 0; i < NUM_MSGS; i++) {
+    memset(msg, i & 0xFF, sizeof(msg));
+    memcpy(msg, &i, sizeof(i));
+    TEST_ASSERT(cbuf_write_blocking(cbuf, msg, sizeof(msg), -1) ==
+                    sizeof(msg),
+                "Write failed");
+  }
+  TEST_ASSERT(cbuf_flush(cbuf) >= 0, "Flush failed");
+  return NULL;
+}
+
+void test_batch_basic() {
+  cbuf_t cbuf;
+  cbuf_segs_t segs;
+  uint8_t buf[CBUF_MIN_CAPACITY];
+
+  memset(buf, 0xA5, sizeof(buf));
+  TEST_ASSERT(cbuf_init(&cbuf, CBUF_MIN_CAPACITY) == 0, "Init failed");
+
+  TEST_ASSERT(cbuf_set_batching(NULL, 64, 0) == -1, "NULL must fail");
+  TEST_ASSERT(cbuf_set_batching(&cbuf, 64, -1) == -1,
+              "Negative age must fail");
+  TEST_ASSERT(cbuf_flush(&cbuf) == 0, "Nothing to flush");
+
+  /* Held back until the size limit is reached */
+  TEST_ASSERT(cbuf_set_batching(&cbuf, 64, 0) == 0, "Set batching failed");
+  TEST_ASSERT(cbuf_write_blocking(&cbuf, buf, 40, 0) == 40, "Write failed");
+  TEST_ASSERT(cbuf_get_readable_size(&cbuf) == 0,
+              "Pending bytes must not be readable");
+  TEST_ASSERT(cbuf_write_blocking(&cbuf, buf, 40, 0) == 40, "Write failed");
+  TEST_ASSERT(cbuf_get_readable_size(&cbuf) == 80,
+              "Size limit must publish");
+
+  /* Explicit flush; zero-copy commits are batched too */
+  TEST_ASSERT(cbuf_get_write_segs(&cbuf, &segs) == CBUF_MIN_CAPACITY - 1 - 80,
+              "Wrong writable size");
+  TEST_ASSERT(cbuf_commit(&cbuf, 10) == 10, "Commit failed");
+  TEST_ASSERT(cbuf_get_write_segs(&cbuf, &segs) == CBUF_MIN_CAPACITY - 1 - 90,
+              "Pending bytes must not be writable again");
+  TEST_ASSERT(cbuf_get_readable_size(&cbuf) == 80,
+              "Pending commit must not be readable");
+  TEST_ASSERT(cbuf_flush(&cbuf) == 10, "Flush must publish the commit");
+  TEST_ASSERT(cbuf_get_readable_size(&cbuf) == 90, "Flush failed");
+  TEST_ASSERT(cbuf_flush(&cbuf) == 0, "Nothing left to flush");
+
+  /* Age limit */
+  TEST_ASSERT(cbuf_set_batching(&cbuf, SIZE_MAX, 2000) == 0,
+              "Set batching failed");
+  TEST_ASSERT(cbuf_write_blocking(&cbuf, buf, 1, 0) == 1, "Write failed");
+  TEST_ASSERT(cbuf_get_readable_size(&cbuf) == 90,
+              "Young pending bytes must not be readable");
+  usleep(5000);
+  TEST_ASSERT(cbuf_write_blocking(&cbuf, buf, 1, 0) == 1, "Write failed");
+  TEST_ASSERT(cbuf_get_readable_size(&cbuf) == 92, "Age limit must publish");
+
+  /* Disabling publishes whatever is pending */
+  TEST_ASSERT(cbuf_write_blocking(&cbuf, buf, 8, 0) == 8, "Write failed");
+  TEST_ASSERT(cbuf_set_batching(&cbuf, 0, 0) == 0, "Disable failed");
+  TEST_ASSERT(cbuf_get_readable_size(&cbuf) == 100,
+              "Disabling must publish pending bytes");
+  TEST_ASSERT(cbuf_write_blocking(&cbuf, buf, 1, 0) == 1, "Write failed");
+  TEST_ASSERT(cbuf_get_readable_size(&cbuf) == 101,
+              "Writes must publish immediately once disabled");
+
+  cbuf_free(&cbuf);
+}
+
+void test_batch_full() {
+  cbuf_t cbuf;
+  uint8_t buf[CBUF_MIN_CAPACITY];
+
+  memset(buf, 0x5A, sizeof(buf));
+  TEST_ASSERT(cbuf_init(&cbuf, CBUF_MIN_CAPACITY) == 0, "Init failed");
+
+  /* Publish only on flush, then fill the ring with pending bytes */
+  TEST_ASSERT(cbuf_set_batching(&cbuf, SIZE_MAX, 0) == 0,
+              "Set batching failed");
+  TEST_ASSERT(cbuf_write_blocking(&cbuf, buf, CBUF_MIN_CAPACITY - 1, 0) ==
+                  CBUF_MIN_CAPACITY - 1,
+              "Write failed");
+  TEST_ASSERT(cbuf_get_readable_size(&cbuf) == 0,
+              "Pending bytes must not be readable");
+
+  /* A write that has to wait must publish first instead of deadlocking */
+  TEST_ASSERT(cbuf_write_blocking(&cbuf, buf, 1, 10) == 0,
+              "Write to a full ring must time out");
+  TEST_ASSERT(cbuf_get_readable_size(&cbuf) == CBUF_MIN_CAPACITY - 1,
+              "Waiting writer must publish pending bytes");
+
+  cbuf_free(&cbuf);
+}
+
+void test_batch_threaded() {
+  cbuf_t cbuf;
+  pthread_t producer;
+  uint8_t msg[MSG_SIZE];
+
+  TEST_ASSERT(cbuf_init(&cbuf, 4096) == 0, "Init failed");
+  pthread_create(&producer, NULL, batch_producer, &cbuf);
+
+  for (uint32_t i = 0; i < NUM_MSGS; i++) {
+    uint32_t seq;
+
+    TEST_ASSERT(cbuf_read_blocking(&cbuf, msg, sizeof(msg), 5000, true) ==
+                    sizeof(msg),
+                "Read timed out; batched bytes were never published");
+    memcpy(&seq, msg, sizeof(seq));
+    TEST_ASSERT(seq == i, "Out of order message");
+    TEST_ASSERT(msg[MSG_SIZE - 1] == (i & 0xFF), "Corrupted message");
+  }
+
+  pthread_join(producer, NULL);
+  TEST_ASSERT(cbuf_is_empty(&cbuf) == 1, "Ring must be drained");
+  cbuf_free(&cbuf);
+}
+
+int main() {
+  printf("Running batching tests...\n");
+
+  test_batch_basic();
+  printf("\x1B[92m  ✓ basic batching tests passed\x1B[0m\n");
+
+  test_batch_full();
+  printf("\x1B[92m  ✓ full ring batching test passed\x1B[0m\n");
+
+  test_batch_threaded();
+  printf("\x1B[92m  ✓ threaded batching test passed\x1B[0m\n");
+
+  printf("All batching tests passed!\n");
+  return 0;
+}
@@ -0,0 +1,189 @@
+#include "cbuf_coro.hpp"
+#include "test_utils.h"
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+/* Fire-and-forget coroutine type; runs eagerly until its first suspension */
+struct task {
+  struct promise_type {
+    task get_return_object() noexcept { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { abort(); }
+  };
+};
+
+/* Single-threaded executor: a FIFO of runnable coroutines */
+struct executor {
+  std::deque<std::coroutine_handle<>> ready;
+
+  static void post(std::coroutine_handle<> h, void *arg) {
+    static_cast<executor *>(arg)->ready.push_back(h);
+  }
+
+  size_t run() {
+    size_t resumed = 0;
+    while (!ready.empty()) {
+      auto h = ready.front();
+      ready.pop_front();
+      h.resume();
+      resumed++;
+    }
+    return resumed;
+  }
+};
+
+static const size_t NUM_MSGS = 5000;
+
+task producer(cbuf::async_ring &ar, uint32_t id, size_t *done) {
+  uint8_t msg[100];
+
+  for (size_t i = 0; i < NUM_MSGS; i++) {
+    for (size_t j = 0; j < sizeof(msg); j++)
+      msg[j] = (id + i + j) & 0xFF;
+    ssize_t n = co_await ar.async_write({msg, sizeof(msg)});
+    TEST_ASSERT(n == sizeof(msg), "async_write failed");
+  }
+  (*done)++;
+}
+
+task consumer(cbuf::async_ring &ar, uint32_t id, size_t *done) {
+  uint8_t buf[64];
+  size_t total = 0, expect_total = NUM_MSGS * 100;
+
+  while (total < expect_total) {
+    size_t want = MIN(sizeof(buf), expect_total - total);
+    ssize_t n = co_await ar.async_read({buf, want});
+    TEST_ASSERT(n > 0, "async_read failed");
+    for (ssize_t k = 0; k < n; k++, total++) {
+      size_t i = total / 100, j = total % 100;
+      TEST_ASSERT(buf[k] == ((id + i + j) & 0xFF), "Data mismatch");
+    }
+  }
+  (*done)++;
+}
+
+void test_executor_multiplexing() {
+  const size_t num_rings = 16;
+  executor ex;
+  std::vector<std::unique_ptr<cbuf::ring>> rings;
+  std::vector<std::unique_ptr<cbuf::async_ring>> arings;
+  size_t produced = 0, consumed = 0;
+
+  for (size_t i = 0; i < num_rings; i++) {
+    rings.push_back(std::make_unique<cbuf::ring>(CBUF_MIN_CAPACITY));
+    arings.push_back(
+        std::make_unique<cbuf::async_ring>(*rings[i], &executor::post, &ex));
+  }
+
+  /* Start half the consumers first so that both sides get to park */
+  for (size_t i = 0; i < num_rings; i++) {
+    if (i % 2)
+      consumer(*arings[i], i, &consumed);
+    producer(*arings[i], i, &produced);
+    if (!(i % 2))
+      consumer(*arings[i], i, &consumed);
+  }
+
+  size_t resumed = ex.run();
+
+  TEST_ASSERT(produced == num_rings, "Not all producers completed");
+  TEST_ASSERT(consumed == num_rings, "Not all consumers completed");
+  TEST_ASSERT(resumed > 0, "Coroutines must have been parked and resumed");
+  for (auto &r : rings)
+    TEST_ASSERT(r->empty(), "Rings must be empty after the test");
+}
+
+void test_inline_resume() {
+  cbuf::ring r(CBUF_MIN_CAPACITY);
+  cbuf::async_ring ar(r);
+  size_t produced = 0, consumed = 0;
+
+  /* No executor: each side resumes the other directly */
+  consumer(ar, 7, &consumed);
+  producer(ar, 7, &produced);
+
+  TEST_ASSERT(produced == 1 && consumed == 1, "Coroutines did not complete");
+  TEST_ASSERT(r.empty(), "Ring must be empty after the test");
+}
+
+task relay(cbuf::async_ring &in, cbuf::async_ring *out, size_t nbytes,
+           size_t *done) {
+  uint8_t buf[16];
+
+  while (nbytes) {
+    ssize_t n = co_await in.async_read({buf, MIN(sizeof(buf), nbytes)});
+    TEST_ASSERT(n > 0, "async_read failed");
+    if (out)
+      TEST_ASSERT(co_await out->async_write({buf, static_cast<size_t>(n)}) ==
+                      n,
+                  "async_write failed");
+    nbytes -= static_cast<size_t>(n);
+  }
+  (*done)++;
+}
+
+task feed(cbuf::async_ring &out, size_t nbytes) {
+  uint8_t msg[16] = {1, 2, 3};
+
+  for (; nbytes; nbytes -= sizeof(msg))
+    TEST_ASSERT(co_await out.async_write({msg, sizeof(msg)}) == sizeof(msg),
+                "async_write failed");
+}
+
+void test_inline_resume_chain() {
+  /* Deep enough to overflow the stack if every wakeup nested a resume */
+  const size_t num_stages = 100000;
+  std::vector<std::unique_ptr<cbuf::ring>> rings;
+  std::vector<std::unique_ptr<cbuf::async_ring>> arings;
+  size_t done = 0;
+
+  for (size_t i = 0; i < num_stages; i++) {
+    rings.push_back(std::make_unique<cbuf::ring>(CBUF_MIN_CAPACITY));
+    arings.push_back(std::make_unique<cbuf::async_ring>(*rings[i]));
+  }
+
+  /* Every stage parks on its empty input, then the source feeds the chain */
+  for (size_t i = num_stages; i-- > 0;)
+    relay(*arings[i], (i + 1 < num_stages) ? arings[i + 1].get() : nullptr,
+          64, &done);
+  feed(*arings[0], 64);
+
+  TEST_ASSERT(done == num_stages, "Not all stages completed");
+}
+
+task oversized_write(cbuf::async_ring &ar, ssize_t *res) {
+  static uint8_t big[CBUF_MIN_CAPACITY];
+  *res = co_await ar.async_write({big, sizeof(big)});
+}
+
+void test_invalid_args() {
+  cbuf::ring r(CBUF_MIN_CAPACITY);
+  cbuf::async_ring ar(r);
+  ssize_t res = 0;
+
+  oversized_write(ar, &res);
+  TEST_ASSERT(res == -1, "A write larger than the capacity must fail");
+}
+
+int main() {
+  printf("Running coroutine tests...\n");
+
+  test_executor_multiplexing();
+  printf("\x1B[92m  ✓ executor multiplexing test passed\x1B[0m\n");
+
+  test_inline_resume();
+  printf("\x1B[92m  ✓ inline resume test passed\x1B[0m\n");
+
+  test_inline_resume_chain();
+  printf("\x1B[92m  ✓ inline resume chain test passed\x1B[0m\n");
+
+  test_invalid_args();
+  printf("\x1B[92m  ✓ invalid argument tests passed\x1B[0m\n");
+
+  printf("All coroutine tests passed!\n");
+  return 0;
+}
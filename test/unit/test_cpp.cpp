@@ -0,0 +1,147 @@
+#include "cbuf.hpp"
+#include "test_utils.h"
+
+#include <array>
+#include <thread>
+
+#if defined(_Alignas) || defined(_Atomic) || defined(restrict)
+#error "cbuf.h must not leak its C compatibility macros"
+#endif
+
+struct item {
+  uint64_t seq;
+  uint32_t kind;
+  uint32_t crc;
+};
+
+void test_ring_ownership() {
+  bool threw = false;
+  try {
+    cbuf::ring bad(10);
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  TEST_ASSERT(threw, "Should throw with size < CBUF_MIN_CAPACITY");
+
+  cbuf::ring a(CBUF_MIN_CAPACITY);
+  TEST_ASSERT(a, "Ring must be valid after construction");
+  TEST_ASSERT(a.capacity() == CBUF_MIN_CAPACITY - 1, "Incorrect capacity");
+  TEST_ASSERT(a.empty(), "New ring must be empty");
+
+  TEST_ASSERT(a.push(uint32_t{0xdeadbeef}), "Push failed");
+  cbuf_t *handle = a.native_handle();
+
+  /* Moving transfers the same cbuf_t, data and all */
+  cbuf::ring b(std::move(a));
+  TEST_ASSERT(!a, "Moved-from ring must be empty");
+  TEST_ASSERT(a.consume(1) == 0 && a.commit(1) == 0,
+              "A moved-from ring must not report progress");
+  TEST_ASSERT(b.native_handle() == handle, "Handle must survive a move");
+
+  cbuf::ring c;
+  c = std::move(b);
+  uint32_t v = 0;
+  TEST_ASSERT(c.pop(v, cbuf::nowait) && v == 0xdeadbeef,
+              "Data must survive a move");
+}
+
+void test_push_pop_timeouts() {
+  using namespace std::chrono_literals;
+  cbuf::ring r(CBUF_MIN_CAPACITY);
+  item in{1, 2, 3}, out{};
+
+  TEST_ASSERT(!r.pop(out, 1ms), "Pop from empty ring must time out");
+  TEST_ASSERT(!r.pop(out, 500us), "Sub-millisecond timeouts must work");
+
+  size_t n = 0;
+  while (r.push(in, cbuf::nowait))
+    n++;
+  TEST_ASSERT(n == r.capacity() / sizeof(item), "Ring must fill up");
+
+  TEST_ASSERT(r.pop(out) && out.seq == 1 && out.kind == 2 && out.crc == 3,
+              "Popped item mismatch");
+}
+
+void test_views() {
+  cbuf::ring r(CBUF_MIN_CAPACITY);
+  std::array<uint8_t, 300> in{}, out{};
+
+  for (size_t i = 0; i < in.size(); i++)
+    in[i] = i & 0xFF;
+
+  /* Move the indices close to the end to force a wrap */
+  TEST_ASSERT(r.write({in.data(), in.size()}, cbuf::nowait) == 300,
+              "Write failed");
+  TEST_ASSERT(r.remove(300) == 300, "Remove failed");
+
+  cbuf::view wv = r.write_view();
+  TEST_ASSERT(wv.size() == r.capacity(), "Write view must span all space");
+  TEST_ASSERT(!wv.second().empty(), "Write view must wrap around");
+
+  size_t len0 = MIN(wv.first().size(), in.size());
+  memcpy(wv.first().data(), in.data(), len0);
+  memcpy(wv.second().data(), in.data() + len0, in.size() - len0);
+  TEST_ASSERT(r.commit(in.size()) == in.size(), "Commit failed");
+  TEST_ASSERT(r.readable_size() == in.size(), "Commit must publish data");
+
+  cbuf::view rv = r.read_view();
+  TEST_ASSERT(rv.size() == in.size(), "Read view size mismatch");
+  size_t i = 0;
+  for (uint8_t b : rv.first())
+    out[i++] = b;
+  for (uint8_t b : rv.second())
+    out[i++] = b;
+  TEST_ASSERT(out == in, "Read view data mismatch");
+
+  /* Random access into the readable data, across the wrap */
+  cbuf::view av = r.view_at(len0 - 4, 8);
+  TEST_ASSERT(av.first().size() == 4 && av.second().size() == 4,
+              "View at must split at the wrap");
+  TEST_ASSERT(av.second()[0] == in[len0], "View at data mismatch");
+  uint8_t b = 0;
+  TEST_ASSERT(r.peek_at(250, {&b, 1}) == 1 && b == in[250],
+              "Peek at failed");
+  TEST_ASSERT(r.consume(rv.size()) == in.size(), "Consume failed");
+  TEST_ASSERT(r.empty(), "Ring must be empty after consuming the view");
+}
+
+void test_threaded_push_pop() {
+  cbuf::ring r(4096);
+  constexpr uint64_t num_items = 100000;
+
+  std::thread producer([&] {
+    for (uint64_t i = 0; i < num_items; i++)
+      TEST_ASSERT(r.push(item{i, 0, 0}), "Push failed");
+  });
+
+  std::thread consumer([&] {
+    item it;
+    for (uint64_t i = 0; i < num_items; i++) {
+      TEST_ASSERT(r.pop(it), "Pop failed");
+      TEST_ASSERT(it.seq == i, "Out of order item");
+    }
+  });
+
+  producer.join();
+  consumer.join();
+  TEST_ASSERT(r.empty(), "Ring must be empty after the test");
+}
+
+int main() {
+  printf("Running C++ wrapper tests (C++%ld)...\n", __cplusplus / 100 % 100);
+
+  test_ring_ownership();
+  printf("\x1B[92m  ✓ ownership tests passed\x1B[0m\n");
+
+  test_push_pop_timeouts();
+  printf("\x1B[92m  ✓ push/pop tests passed\x1B[0m\n");
+
+  test_views();
+  printf("\x1B[92m  ✓ zero-copy view tests passed\x1B[0m\n");
+
+  test_threaded_push_pop();
+  printf("\x1B[92m  ✓ threaded push/pop test passed\x1B[0m\n");
+
+  printf("All C++ wrapper tests passed!\n");
+  return 0;
+}
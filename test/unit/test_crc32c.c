@@ -0,0 +1,82 @@
+#include "cbuf.h"
+#include "cbuf_crc32c.h"
+#include "test_utils.h"
+
+void test_known_vectors(bool hw) {
+  const char *check = "123456789";
+  uint8_t zeros[32] = {0}, copy[32];
+
+  if (cbuf_crc32c_set_hw(hw) != 0) {
+    printf("  (hardware CRC32C not supported, skipped)\n");
+    return;
+  }
+
+  TEST_ASSERT(cbuf_crc32c(0, check, 9) == 0xE3069283, "Check value mismatch");
+  TEST_ASSERT(cbuf_crc32c(0, zeros, 32) == 0x8A9136AA,
+              "32 zero bytes checksum mismatch");
+  TEST_ASSERT(cbuf_crc32c(0, check, 0) == 0, "Empty checksum must be 0");
+
+  /* Chaining over split buffers */
+  TEST_ASSERT(cbuf_crc32c(cbuf_crc32c(0, check, 4), check + 4, 5) ==
+                  0xE3069283,
+              "Chained checksum mismatch");
+
+  memset(copy, 0xFF, sizeof(copy));
+  TEST_ASSERT(cbuf_crc32c_copy(0, copy, check, 9) == 0xE3069283,
+              "Copy checksum mismatch");
+  TEST_ASSERT(!memcmp(copy, check, 9) && copy[9] == 0xFF,
+              "Copy must copy exactly n bytes");
+}
+
+void test_fused_ring_io() {
+  cbuf_t cbuf;
+  uint8_t in[300], out[300];
+  uint32_t wcrc, rcrc;
+
+  TEST_ASSERT(cbuf_init(&cbuf, CBUF_MIN_CAPACITY) == 0,
+              "Initialization failed");
+  for (size_t i = 0; i < sizeof(in); i++)
+    in[i] = (i * 7 + 3) & 0xFF;
+
+  /* Several rounds so that the data wraps around the end of the ring */
+  for (int round = 0; round < 8; round++) {
+    size_t n = 100 + round * 25;
+
+    wcrc = 0;
+    rcrc = 0;
+    TEST_ASSERT(cbuf_write_crc32c(&cbuf, in, n, 0, &wcrc) == (ssize_t)n,
+                "Write failed");
+    TEST_ASSERT(wcrc == cbuf_crc32c(0, in, n), "Write checksum mismatch");
+
+    TEST_ASSERT(cbuf_read_crc32c(&cbuf, out, n, 0, true, &rcrc) == (ssize_t)n,
+                "Read failed");
+    TEST_ASSERT(rcrc == wcrc, "Read checksum mismatch");
+    TEST_ASSERT(!memcmp(in, out, n), "Data mismatch");
+  }
+
+  /* Nothing read, checksum untouched */
+  rcrc = 0x1234;
+  TEST_ASSERT(cbuf_read_crc32c(&cbuf, out, 10, 0, true, &rcrc) == 0,
+              "Read from empty ring must time out");
+  TEST_ASSERT(rcrc == 0x1234, "Checksum must be unchanged");
+  TEST_ASSERT(cbuf_write_crc32c(&cbuf, in, 10, 0, NULL) == -1,
+              "NULL crc must be rejected");
+
+  cbuf_free(&cbuf);
+}
+
+int main() {
+  printf("Running CRC32C tests...\n");
+
+  test_known_vectors(false);
+  printf("\x1B[92m  ✓ table CRC32C tests passed\x1B[0m\n");
+
+  test_known_vectors(true);
+  printf("\x1B[92m  ✓ hardware CRC32C tests passed\x1B[0m\n");
+
+  test_fused_ring_io();
+  printf("\x1B[92m  ✓ fused read/write tests passed\x1B[0m\n");
+
+  printf("All CRC32C tests passed!\n");
+  return 0;
+}
@@ -0,0 +1,146 @@
+#include "cbuf_file.h"
+#include "test_utils.h"
+
+#include <sys/wait.h>
+
+static char path[] = "/tmp/cbuf_test_file_XXXXXX";
+
+void test_create_reopen() {
+  cbuf_t cbuf;
+  uint8_t data[100], out[100];
+
+  for (int i = 0; i < 100; i++)
+    data[i] = i;
+
+  TEST_ASSERT(cbuf_open_file(&cbuf, path, 0) == -1,
+              "Opening a missing file without a capacity must fail");
+  TEST_ASSERT(cbuf_open_file(&cbuf, path, 10) == -1,
+              "Should fail with size < CBUF_MIN_CAPACITY");
+
+  TEST_ASSERT(cbuf_open_file(&cbuf, path, 1024) == 0, "Create failed");
+  TEST_ASSERT(cbuf_get_capacity(&cbuf) == 1023, "Incorrect capacity");
+  TEST_ASSERT(cbuf_is_empty(&cbuf) > 0, "New file ring must be empty");
+
+  TEST_ASSERT(cbuf_write_blocking(&cbuf, data, 100, 0) == 100, "Write failed");
+  TEST_ASSERT(cbuf_read_blocking(&cbuf, out, 40, 0, true) == 40, "Read failed");
+  TEST_ASSERT(cbuf_close_file(&cbuf) == 0, "Close failed");
+
+  /* Clean close syncs, so the unread data is all there */
+  TEST_ASSERT(cbuf_open_file(&cbuf, path, 2048) == -1,
+              "Capacity mismatch must fail");
+  TEST_ASSERT(cbuf_open_file(&cbuf, path, 0) == 0, "Reopen failed");
+  TEST_ASSERT(cbuf_get_readable_size(&cbuf) == 60, "Unread data not recovered");
+  TEST_ASSERT(cbuf_read_blocking(&cbuf, out, 60, 0, true) == 60, "Read failed");
+  TEST_ASSERT(!memcmp(out, data + 40, 60), "Recovered data mismatch");
+  cbuf_free(&cbuf);
+}
+
+void test_crash_recovery() {
+  cbuf_t cbuf;
+  uint8_t data[300], out[300];
+  pid_t pid;
+  int status;
+
+  for (int i = 0; i < 300; i++)
+    data[i] = (i * 3) & 0xFF;
+
+  pid = fork();
+  TEST_ASSERT(pid >= 0, "fork failed");
+  if (pid == 0) {
+    /* Write and consume, sync, then keep going and "crash" */
+    if (cbuf_open_file(&cbuf, path, 0) != 0)
+      _exit(1);
+    if (cbuf_write_blocking(&cbuf, data, 300, 0) != 300)
+      _exit(1);
+    if (cbuf_read_blocking(&cbuf, out, 100, 0, true) != 100)
+      _exit(1);
+    if (cbuf_sync(&cbuf) != 0)
+      _exit(1);
+    if (cbuf_write_blocking(&cbuf, data, 50, 0) != 50)
+      _exit(1);
+    if (cbuf_read_blocking(&cbuf, out, 150, 0, true) != 150)
+      _exit(1);
+    _exit(0);
+  }
+
+  TEST_ASSERT(waitpid(pid, &status, 0) == pid, "waitpid failed");
+  TEST_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0,
+              "Child process failed");
+
+  /* Recovered as of the last sync: 200 unread bytes, not 100 */
+  TEST_ASSERT(cbuf_open_file(&cbuf, path, 0) == 0, "Reopen failed");
+  TEST_ASSERT(cbuf_get_readable_size(&cbuf) == 200,
+              "Ring not recovered as of the last sync");
+  TEST_ASSERT(cbuf_read_blocking(&cbuf, out, 200, 0, true) == 200,
+              "Read failed");
+  TEST_ASSERT(!memcmp(out, data + 100, 200), "Recovered data mismatch");
+  cbuf_free(&cbuf);
+}
+
+void test_corrupt_file() {
+  cbuf_t cbuf;
+  FILE *f = fopen(path, "r+b");
+  uint64_t bad = 0;
+
+  TEST_ASSERT(f != NULL, "fopen failed");
+  TEST_ASSERT(fwrite(&bad, sizeof(bad), 1, f) == 1, "fwrite failed");
+  fclose(f);
+
+  TEST_ASSERT(cbuf_open_file(&cbuf, path, 0) == -1,
+              "File with a bad magic must be rejected");
+}
+
+void test_min_capacity_reopen() {
+  cbuf_t cbuf;
+  uint8_t data[100], out[100];
+
+  for (int i = 0; i < 100; i++)
+    data[i] = 255 - i;
+
+  TEST_ASSERT(truncate(path, 0) == 0, "truncate failed");
+  TEST_ASSERT(cbuf_open_file(&cbuf, path, CBUF_MIN_CAPACITY) == 0,
+              "Create failed");
+  TEST_ASSERT(cbuf_write_blocking(&cbuf, data, 100, 0) == 100, "Write failed");
+  TEST_ASSERT(cbuf_close_file(&cbuf) == 0, "Close failed");
+
+  /* The smallest valid file must reopen with its data */
+  TEST_ASSERT(cbuf_open_file(&cbuf, path, 0) == 0, "Reopen failed");
+  TEST_ASSERT(cbuf_get_capacity(&cbuf) == CBUF_MIN_CAPACITY - 1,
+              "Incorrect capacity");
+  TEST_ASSERT(cbuf_read_blocking(&cbuf, out, 100, 0, true) == 100,
+              "Unread data not recovered");
+  TEST_ASSERT(!memcmp(out, data, 100), "Recovered data mismatch");
+  TEST_ASSERT(cbuf_close_file(&cbuf) == 0, "Close failed");
+
+  /* Anything shorter is not a valid ring */
+  TEST_ASSERT(truncate(path, CBUF_FILE_HDR_SIZE + CBUF_MIN_CAPACITY - 1) == 0,
+              "truncate failed");
+  TEST_ASSERT(cbuf_open_file(&cbuf, path, 0) == -1,
+              "Truncated file must be rejected");
+}
+
+int main() {
+  int fd;
+
+  printf("Running file-backed cbuf tests...\n");
+
+  fd = mkstemp(path);
+  TEST_ASSERT(fd >= 0, "mkstemp failed");
+  close(fd);
+
+  test_create_reopen();
+  printf("\x1B[92m  ✓ create/reopen tests passed\x1B[0m\n");
+
+  test_crash_recovery();
+  printf("\x1B[92m  ✓ crash recovery test passed\x1B[0m\n");
+
+  test_corrupt_file();
+  printf("\x1B[92m  ✓ corrupt file test passed\x1B[0m\n");
+
+  test_min_capacity_reopen();
+  printf("\x1B[92m  ✓ min capacity reopen test passed\x1B[0m\n");
+
+  unlink(path);
+  printf("All file-backed cbuf tests passed!\n");
+  return 0;
+}
@@ -0,0 +1,138 @@
+#include "cbuf_group.h"
+#include "test_utils.h"
+
+#define NUM_RINGS 8
+#define NUM_MSGS 2000
+#define MSG_SIZE 16
+
+typedef struct {
+  cbuf_t *cbuf;
+  uint32_t id;
+} producer_arg_t;
+
+void *group_producer(void *arg) {
+  producer_arg_t *p = (producer_arg_t *)arg;
+  uint8_t msg[MSG_SIZE];
+
+  for (uint32_t i = 0; i < NUM_MSGS; i++) {
+    memset(msg, (p->id + i) & 0xFF, sizeof(msg));
+    TEST_ASSERT(cbuf_write_blocking(p->cbuf, msg, sizeof(msg), -1) ==
+                    sizeof(msg),
+                "Write failed");
+    /* Bursty traffic, so rings keep going back to empty */
+    if (i % 64 == 0)
+      usleep(100);
+  }
+  return NULL;
+}
+
+void test_group_basic() {
+  cbuf_group_t group;
+  cbuf_t a, b;
+  uint64_t ready;
+  uint8_t byte = 0x5A;
+
+  TEST_ASSERT(cbuf_group_init(&group) == 0, "Group init failed");
+  TEST_ASSERT(cbuf_init(&a, CBUF_MIN_CAPACITY) == 0, "Init failed");
+  TEST_ASSERT(cbuf_init(&b, CBUF_MIN_CAPACITY) == 0, "Init failed");
+
+  TEST_ASSERT(cbuf_group_add(&group, &a) == 0, "Add failed");
+  TEST_ASSERT(cbuf_group_add(&group, &b) == 1, "Add failed");
+  TEST_ASSERT(cbuf_group_add(&group, &b) == -1, "Double add must fail");
+  TEST_ASSERT(cbuf_group_get(&group, 1) == &b, "Wrong member at index");
+
+  TEST_ASSERT(cbuf_group_wait(&group, &ready, 0) == 0,
+              "Empty group must time out");
+  TEST_ASSERT(cbuf_group_wait(&group, &ready, 20) == 0,
+              "Empty group must time out");
+
+  /* Empty to non-empty edge raises the bit */
+  TEST_ASSERT(cbuf_write_blocking(&b, &byte, 1, 0) == 1, "Write failed");
+  TEST_ASSERT(cbuf_group_wait(&group, &ready, 0) == 1 && ready == 2,
+              "Only b must be ready");
+
+  /* Left unread, so still ready */
+  TEST_ASSERT(cbuf_group_wait(&group, &ready, 0) == 1 && ready == 2,
+              "b must stay ready while it holds data");
+
+  TEST_ASSERT(cbuf_read_blocking(&b, &byte, 1, 0, true) == 1, "Read failed");
+  TEST_ASSERT(cbuf_group_wait(&group, &ready, 0) == 0,
+              "Drained group must time out");
+
+  /* Zero-copy commits publish through the same path */
+  cbuf_segs_t segs;
+  TEST_ASSERT(cbuf_get_write_segs(&a, &segs) > 0, "No space");
+  segs.ptr[0][0] = 1;
+  TEST_ASSERT(cbuf_commit(&a, 1) == 1, "Commit failed");
+  TEST_ASSERT(cbuf_group_wait(&group, &ready, 0) == 1 && ready == 1,
+              "Only a must be ready");
+
+  TEST_ASSERT(cbuf_group_remove(&group, &a) == 0, "Remove failed");
+  TEST_ASSERT(cbuf_group_wait(&group, &ready, 0) == 0,
+              "Removed member must not be reported");
+  TEST_ASSERT(cbuf_group_add(&group, &a) == 0, "Re-add must reuse the slot");
+  TEST_ASSERT(cbuf_group_wait(&group, &ready, 0) == 1 && ready == 1,
+              "Re-added member with data must be ready");
+
+  cbuf_free(&a);
+  cbuf_free(&b);
+}
+
+void test_group_many_producers() {
+  cbuf_group_t group;
+  cbuf_t cbufs[NUM_RINGS];
+  producer_arg_t args[NUM_RINGS];
+  pthread_t producers[NUM_RINGS];
+  uint32_t received[NUM_RINGS] = {0};
+  uint8_t msg[MSG_SIZE];
+  uint64_t ready;
+  size_t total = 0;
+
+  TEST_ASSERT(cbuf_group_init(&group) == 0, "Group init failed");
+  for (int i = 0; i < NUM_RINGS; i++) {
+    TEST_ASSERT(cbuf_init(&cbufs[i], 1024) == 0, "Init failed");
+    TEST_ASSERT(cbuf_group_add(&group, &cbufs[i]) == i, "Add failed");
+    args[i].cbuf = &cbufs[i];
+    args[i].id = i;
+  }
+
+  for (int i = 0; i < NUM_RINGS; i++)
+    pthread_create(&producers[i], NULL, group_producer, &args[i]);
+
+  while (total < NUM_RINGS * NUM_MSGS) {
+    TEST_ASSERT(cbuf_group_wait(&group, &ready, 5000) > 0,
+                "Lost wakeup: timed out with messages outstanding");
+
+    for (; ready; ready &= ready - 1) {
+      unsigned int idx = __builtin_ctzll(ready);
+      cbuf_t *cbuf = cbuf_group_get(&group, idx);
+
+      /* Drain only one message per wakeup to exercise partial reads */
+      if (cbuf_read_blocking(cbuf, msg, sizeof(msg), 0, true) == sizeof(msg)) {
+        TEST_ASSERT(msg[0] == ((idx + received[idx]) & 0xFF),
+                    "Out of order message");
+        received[idx]++;
+        total++;
+      }
+    }
+  }
+
+  for (int i = 0; i < NUM_RINGS; i++) {
+    pthread_join(producers[i], NULL);
+    TEST_ASSERT(received[i] == NUM_MSGS, "Missing messages");
+    cbuf_free(&cbufs[i]);
+  }
+}
+
+int main() {
+  printf("Running group tests...\n");
+
+  test_group_basic();
+  printf("\x1B[92m  ✓ basic group tests passed\x1B[0m\n");
+
+  test_group_many_producers();
+  printf("\x1B[92m  ✓ many producers test passed\x1B[0m\n");
+
+  printf("All group tests passed!\n");
+  return 0;
+}
@@ -0,0 +1,205 @@
+#include "cbuf_pipeline.h"
+#include "test_utils.h"
+
+#define NUM_VALUES 200000
+
+typedef struct {
+  uint32_t next;
+  uint32_t limit; /* 0 for an endless source */
+} source_t;
+
+typedef struct {
+  uint32_t expect;
+  int flushes;
+  bool ok;
+} sink_t;
+
+static int source_fn(cbuf_stage_t *stage, const uint8_t *in, size_t len,
+                     void *arg) {
+  source_t *src = (source_t *)arg;
+  uint32_t vals[64];
+  size_t n = 0;
+
+  (void)in;
+  (void)len;
+  while ((n < ARR_COUNT(vals)) && (!src->limit || (src->next < src->limit)))
+    vals[n++] = src->next++;
+  if (!n)
+    return CBUF_STAGE_EOS;
+
+  TEST_ASSERT(cbuf_stage_emit(stage, (uint8_t *)vals, n * sizeof(uint32_t)) ==
+                  (ssize_t)(n * sizeof(uint32_t)),
+              "Emit failed");
+  return 0;
+}
+
+/* x -> 2x + 1 */
+static int transform_fn(cbuf_stage_t *stage, const uint8_t *in, size_t len,
+                        void *arg) {
+  uint32_t vals[CBUF_PIPELINE_BATCH / sizeof(uint32_t)];
+
+  (void)arg;
+  if (!in)
+    return 0; /* end of stream, nothing buffered */
+
+  TEST_ASSERT(len % sizeof(uint32_t) == 0, "Input must come in whole units");
+  memcpy(vals, in, len);
+  for (size_t i = 0; i < len / sizeof(uint32_t); i++)
+    vals[i] = 2 * vals[i] + 1;
+
+  cbuf_stage_emit(stage, (uint8_t *)vals, len);
+  return 0;
+}
+
+static int failing_fn(cbuf_stage_t *stage, const uint8_t *in, size_t len,
+                      void *arg) {
+  (void)stage;
+  (void)in;
+  (void)len;
+  (void)arg;
+  return -5;
+}
+
+static int sink_fn(cbuf_stage_t *stage, const uint8_t *in, size_t len,
+                   void *arg) {
+  sink_t *sink = (sink_t *)arg;
+  uint32_t v;
+
+  TEST_ASSERT(cbuf_stage_emit(stage, in, len) == -1,
+              "Last stage must not emit");
+  if (!in) {
+    sink->flushes++;
+    return 0;
+  }
+
+  for (size_t i = 0; i < len; i += sizeof(v)) {
+    memcpy(&v, in + i, sizeof(v));
+    if (v != 2 * sink->expect + 1)
+      sink->ok = false;
+    sink->expect++;
+  }
+  return 0;
+}
+
+void test_pipeline_basic() {
+  cbuf_pipeline_t pipeline;
+  cbuf_stage_stats_t stats;
+  source_t src = {0, NUM_VALUES};
+  sink_t sink = {0, 0, true};
+  cbuf_stage_cfg_t cfg;
+
+  TEST_ASSERT(cbuf_pipeline_init(&pipeline) == 0, "Init failed");
+
+  memset(&cfg, 0, sizeof(cfg));
+  TEST_ASSERT(cbuf_pipeline_add(&pipeline, &cfg) == -1,
+              "Stage without a callback must fail");
+
+  cfg = (cbuf_stage_cfg_t){.fn = source_fn, .arg = &src, .cpu = 0};
+  TEST_ASSERT(cbuf_pipeline_add(&pipeline, &cfg) == 0, "Add failed");
+  TEST_ASSERT(cbuf_pipeline_start(&pipeline) == -1,
+              "Pipeline needs at least two stages");
+
+  cfg = (cbuf_stage_cfg_t){
+      .fn = transform_fn, .cpu = -1, .unit = sizeof(uint32_t)};
+  TEST_ASSERT(cbuf_pipeline_add(&pipeline, &cfg) == 1, "Add failed");
+
+  /* Small batches and input cbuf, odd unit boundaries in the cbuf */
+  cfg = (cbuf_stage_cfg_t){.fn = sink_fn,
+                           .arg = &sink,
+                           .cpu = -1,
+                           .batch = 100,
+                           .unit = sizeof(uint32_t),
+                           .capacity = 1001};
+  TEST_ASSERT(cbuf_pipeline_add(&pipeline, &cfg) == 2, "Add failed");
+
+  TEST_ASSERT(cbuf_pipeline_start(&pipeline) == 0, "Start failed");
+  TEST_ASSERT(cbuf_pipeline_join(&pipeline) == 0, "Pipeline failed");
+
+  TEST_ASSERT(sink.ok, "Wrong data at the sink");
+  TEST_ASSERT(sink.expect == NUM_VALUES, "Missing data at the sink");
+  TEST_ASSERT(sink.flushes == 1, "End of stream must reach the sink once");
+
+  TEST_ASSERT(cbuf_pipeline_get_stats(&pipeline, 0, &stats) == 0,
+              "Stats failed");
+  TEST_ASSERT(stats.bytes_out == NUM_VALUES * sizeof(uint32_t),
+              "Wrong source output count");
+  TEST_ASSERT(cbuf_pipeline_get_stats(&pipeline, 2, &stats) == 0,
+              "Stats failed");
+  TEST_ASSERT(stats.bytes_in == NUM_VALUES * sizeof(uint32_t),
+              "Wrong sink input count");
+  TEST_ASSERT(stats.calls > stats.bytes_in / 100, "Batch limit not applied");
+  TEST_ASSERT(stats.occupancy_max > 0 && stats.occupancy_max <= 1000,
+              "Wrong occupancy");
+  TEST_ASSERT(stats.samples == stats.calls - 1,
+              "Occupancy must be sampled once per data call");
+  TEST_ASSERT(stats.occupancy_sum >= stats.bytes_in &&
+                  stats.occupancy_sum <= stats.samples * 1000,
+              "Wrong occupancy sum");
+  TEST_ASSERT(stats.elapsed_usec > 0, "Wrong elapsed time");
+  TEST_ASSERT(cbuf_pipeline_get_stats(&pipeline, 3, &stats) == -1,
+              "Out of range stage must fail");
+
+  cbuf_pipeline_free(&pipeline);
+}
+
+void test_pipeline_stop_and_error() {
+  cbuf_pipeline_t pipeline;
+  source_t src = {0, 0};
+  sink_t sink = {0, 0, true};
+  cbuf_stage_cfg_t cfg;
+
+  /* Endless source, stopped from outside */
+  TEST_ASSERT(cbuf_pipeline_init(&pipeline) == 0, "Init failed");
+  cfg = (cbuf_stage_cfg_t){.fn = source_fn, .arg = &src, .cpu = -1};
+  TEST_ASSERT(cbuf_pipeline_add(&pipeline, &cfg) == 0, "Add failed");
+  cfg = (cbuf_stage_cfg_t){
+      .fn = transform_fn, .cpu = -1, .unit = sizeof(uint32_t)};
+  TEST_ASSERT(cbuf_pipeline_add(&pipeline, &cfg) == 1, "Add failed");
+  cfg = (cbuf_stage_cfg_t){
+      .fn = sink_fn, .arg = &sink, .cpu = -1, .unit = sizeof(uint32_t)};
+  TEST_ASSERT(cbuf_pipeline_add(&pipeline, &cfg) == 2, "Add failed");
+
+  TEST_ASSERT(cbuf_pipeline_start(&pipeline) == 0, "Start failed");
+  usleep(20000);
+  cbuf_pipeline_stop(&pipeline);
+  TEST_ASSERT(cbuf_pipeline_join(&pipeline) == 0, "Pipeline failed");
+  TEST_ASSERT(sink.ok && (sink.expect == src.next),
+              "Data produced before the stop must reach the sink");
+  TEST_ASSERT(sink.flushes == 1, "End of stream must reach the sink once");
+  cbuf_pipeline_free(&pipeline);
+
+  /* A failing stage ends the stream and stops the stages before it */
+  src = (source_t){0, UINT32_MAX};
+  sink = (sink_t){0, 0, true};
+  TEST_ASSERT(cbuf_pipeline_init(&pipeline) == 0, "Init failed");
+  cfg = (cbuf_stage_cfg_t){.fn = source_fn, .arg = &src, .cpu = -1};
+  TEST_ASSERT(cbuf_pipeline_add(&pipeline, &cfg) == 0, "Add failed");
+  cfg = (cbuf_stage_cfg_t){
+      .fn = transform_fn, .cpu = -1, .unit = sizeof(uint32_t)};
+  TEST_ASSERT(cbuf_pipeline_add(&pipeline, &cfg) == 1, "Add failed");
+  cfg = (cbuf_stage_cfg_t){.fn = failing_fn, .cpu = -1};
+  TEST_ASSERT(cbuf_pipeline_add(&pipeline, &cfg) == 2, "Add failed");
+  cfg = (cbuf_stage_cfg_t){.fn = sink_fn, .arg = &sink, .cpu = -1};
+  TEST_ASSERT(cbuf_pipeline_add(&pipeline, &cfg) == 3, "Add failed");
+
+  TEST_ASSERT(cbuf_pipeline_start(&pipeline) == 0, "Start failed");
+  TEST_ASSERT(cbuf_pipeline_join(&pipeline) == -5,
+              "Stage error must be reported");
+  TEST_ASSERT(src.next < NUM_VALUES * 10, "Source must stop early");
+  TEST_ASSERT(sink.expect == 0 && sink.flushes == 1,
+              "Sink must only see the end of stream");
+  cbuf_pipeline_free(&pipeline);
+}
+
+int main() {
+  printf("Running pipeline tests...\n");
+
+  test_pipeline_basic();
+  printf("\x1B[92m  ✓ basic pipeline tests passed\x1B[0m\n");
+
+  test_pipeline_stop_and_error();
+  printf("\x1B[92m  ✓ pipeline stop/error tests passed\x1B[0m\n");
+
+  printf("All pipeline tests passed!\n");
+  return 0;
+}
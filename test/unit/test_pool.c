@@ -0,0 +1,141 @@
+#include "cbuf_pool.h"
+#include "test_utils.h"
+
+#define NUM_RINGS 64
+#define RING_CAPACITY 1000
+#define NUM_MSGS 20000
+
+void *pool_producer(void *arg) {
+  cbuf_t *cbuf = (cbuf_t *)arg;
+
+  for (uint32_t i = 0; i < NUM_MSGS; i++)
+    TEST_ASSERT(cbuf_write_blocking(cbuf, (uint8_t *)&i, sizeof(i), -1) ==
+                    sizeof(i),
+                "Write failed");
+  return NULL;
+}
+
+void test_pool_basic() {
+  cbuf_pool_t pool;
+  cbuf_t *cbufs[NUM_RINGS], *cbuf;
+  uint8_t buf[RING_CAPACITY];
+
+  TEST_ASSERT(cbuf_pool_init(&pool, CBUF_MIN_CAPACITY - 1, 1, 0) == -1,
+              "Capacity below the minimum must fail");
+  TEST_ASSERT(cbuf_pool_init(&pool, RING_CAPACITY, 0, 0) == -1,
+              "Empty pool must fail");
+  TEST_ASSERT(cbuf_pool_init(&pool, RING_CAPACITY, NUM_RINGS, 0) == 0,
+              "Pool init failed");
+  TEST_ASSERT(cbuf_pool_available(&pool) == NUM_RINGS, "Wrong available count");
+
+  for (int i = 0; i < NUM_RINGS; i++) {
+    cbufs[i] = cbuf_pool_get(&pool);
+    TEST_ASSERT(cbufs[i] != NULL, "Get failed");
+    TEST_ASSERT(((uintptr_t)cbufs[i] % CACHELINE_SIZE) == 0,
+                "Header must be cache line aligned");
+    TEST_ASSERT(cbufs[i]->buf > (uint8_t *)cbufs[i] &&
+                    cbufs[i]->buf < (uint8_t *)(cbufs[i] + 1) + CACHELINE_SIZE,
+                "Buffer must follow its header");
+    TEST_ASSERT(cbuf_get_capacity(cbufs[i]) == RING_CAPACITY - 1,
+                "Wrong capacity");
+    TEST_ASSERT(cbuf_is_empty(cbufs[i]) == 1, "New ring must be empty");
+  }
+  TEST_ASSERT(cbuf_pool_get(&pool) == NULL, "Exhausted pool must fail");
+  TEST_ASSERT(cbuf_pool_available(&pool) == 0, "Wrong available count");
+
+  /* Rings must not overlap */
+  for (int i = 0; i < NUM_RINGS; i++) {
+    memset(buf, i, sizeof(buf));
+    TEST_ASSERT(cbuf_write_blocking(cbufs[i], buf, RING_CAPACITY - 1, 0) ==
+                    RING_CAPACITY - 1,
+                "Write failed");
+  }
+  for (int i = 0; i < NUM_RINGS; i++) {
+    TEST_ASSERT(cbuf_read_blocking(cbufs[i], buf, RING_CAPACITY - 1, 0,
+                                   true) == RING_CAPACITY - 1,
+                "Read failed");
+    for (int j = 0; j < RING_CAPACITY - 1; j++)
+      TEST_ASSERT(buf[j] == i, "Rings overlap");
+  }
+
+  /* LIFO reuse, reset to empty */
+  TEST_ASSERT(cbuf_write_blocking(cbufs[5], buf, 10, 0) == 10, "Write failed");
+  TEST_ASSERT(cbuf_pool_put(&pool, cbufs[5]) == 0, "Put failed");
+  TEST_ASSERT(cbuf_pool_put(&pool, cbufs[5]) == -1, "Double put must fail");
+  TEST_ASSERT(cbuf_pool_available(&pool) == 1, "Wrong available count");
+  cbuf = cbuf_pool_get(&pool);
+  TEST_ASSERT(cbuf == cbufs[5], "Freed slot must be reused");
+  TEST_ASSERT(cbuf_is_empty(cbuf) == 1, "Reused ring must be empty");
+
+  /* cbuf_free() must leave pooled storage alone */
+  cbuf_t local;
+  TEST_ASSERT(cbuf_init(&local, CBUF_MIN_CAPACITY) == 0, "Init failed");
+  TEST_ASSERT(cbuf_pool_put(&pool, &local) == -1,
+              "Non-pooled ring must be rejected");
+  cbuf_free(&local);
+
+  for (int i = 0; i < NUM_RINGS; i++)
+    TEST_ASSERT(cbuf_pool_put(&pool, cbufs[i]) == 0, "Put failed");
+  TEST_ASSERT(cbuf_pool_available(&pool) == NUM_RINGS, "Wrong available count");
+
+  cbuf_pool_free(&pool);
+}
+
+void test_pool_huge_pages() {
+  cbuf_pool_t pool;
+  cbuf_t *cbuf;
+  uint8_t byte = 0x7E;
+
+  /* Falls back to regular pages when none are reserved */
+  TEST_ASSERT(cbuf_pool_init(&pool, 4096, 16, CBUF_POOL_HUGE_PAGES) == 0,
+              "Pool init failed");
+  cbuf = cbuf_pool_get(&pool);
+  TEST_ASSERT(cbuf != NULL, "Get failed");
+  TEST_ASSERT(cbuf_write_blocking(cbuf, &byte, 1, 0) == 1, "Write failed");
+  TEST_ASSERT(cbuf_read_blocking(cbuf, &byte, 1, 0, true) == 1 && byte == 0x7E,
+              "Read failed");
+  TEST_ASSERT(cbuf_pool_put(&pool, cbuf) == 0, "Put failed");
+  cbuf_pool_free(&pool);
+}
+
+void test_pool_threaded() {
+  cbuf_pool_t pool;
+  cbuf_t *cbuf;
+  pthread_t producer;
+
+  TEST_ASSERT(cbuf_pool_init(&pool, CBUF_MIN_CAPACITY, 4, 0) == 0,
+              "Pool init failed");
+
+  for (int round = 0; round < 4; round++) {
+    cbuf = cbuf_pool_get(&pool);
+    TEST_ASSERT(cbuf != NULL, "Get failed");
+    pthread_create(&producer, NULL, pool_producer, cbuf);
+    for (uint32_t i = 0; i < NUM_MSGS; i++) {
+      uint32_t v;
+      TEST_ASSERT(cbuf_read_blocking(cbuf, (uint8_t *)&v, sizeof(v), 5000,
+                                     true) == sizeof(v),
+                  "Read failed");
+      TEST_ASSERT(v == i, "Out of order message");
+    }
+    pthread_join(producer, NULL);
+    TEST_ASSERT(cbuf_pool_put(&pool, cbuf) == 0, "Put failed");
+  }
+
+  cbuf_pool_free(&pool);
+}
+
+int main() {
+  printf("Running pool tests...\n");
+
+  test_pool_basic();
+  printf("\x1B[92m  ✓ basic pool tests passed\x1B[0m\n");
+
+  test_pool_huge_pages();
+  printf("\x1B[92m  ✓ huge page pool test passed\x1B[0m\n");
+
+  test_pool_threaded();
+  printf("\x1B[92m  ✓ threaded pool test passed\x1B[0m\n");
+
+  printf("All pool tests passed!\n");
+  return 0;
+}
@@ -0,0 +1,119 @@
+#include "cbuf_prio.h"
+#include "test_utils.h"
+
+#define NUM_BULK 200000
+#define NUM_URGENT 1000
+
+typedef struct {
+  cbuf_prio_t *prio;
+  cbuf_prio_lane_t lane;
+  uint32_t count;
+} prio_producer_arg_t;
+
+void *prio_producer(void *arg) {
+  prio_producer_arg_t *p = (prio_producer_arg_t *)arg;
+
+  for (uint32_t i = 0; i < p->count; i++)
+    TEST_ASSERT(cbuf_prio_write(p->prio, p->lane, (uint8_t *)&i, sizeof(i),
+                                -1) == sizeof(i),
+                "Write failed");
+  return NULL;
+}
+
+void test_prio_basic() {
+  cbuf_prio_t prio;
+  cbuf_prio_lane_t lane;
+  uint8_t data[1024], out[1024];
+
+  for (int i = 0; i < (int)sizeof(data); i++)
+    data[i] = i & 0xff;
+
+  TEST_ASSERT(cbuf_prio_init(NULL, 512, 4096) == -1, "Init must fail");
+  TEST_ASSERT(cbuf_prio_init(&prio, 1, 4096) == -1,
+              "Init must fail for a bad urgent capacity");
+  TEST_ASSERT(cbuf_prio_init(&prio, 512, 4096) == 0, "Init failed");
+
+  TEST_ASSERT(cbuf_prio_lane(&prio, CBUF_PRIO_URGENT) == &prio.urgent,
+              "Wrong urgent lane");
+  TEST_ASSERT(cbuf_prio_lane(&prio, CBUF_PRIO_BULK) == &prio.bulk,
+              "Wrong bulk lane");
+  TEST_ASSERT(cbuf_prio_write(&prio, (cbuf_prio_lane_t)7, data, 1, 0) == -1,
+              "Write to a bad lane must fail");
+  TEST_ASSERT(cbuf_prio_read(&prio, out, sizeof(out), 0, &lane) == 0,
+              "Empty ring must time out");
+
+  /* Fill the bulk lane; the urgent lane still accepts writes */
+  while (cbuf_prio_write(&prio, CBUF_PRIO_BULK, data, 100, 0) == 100)
+    ;
+  TEST_ASSERT(cbuf_prio_write(&prio, CBUF_PRIO_URGENT, data, 8, 0) == 8,
+              "Urgent write must not be blocked by bulk data");
+  TEST_ASSERT(cbuf_prio_write(&prio, CBUF_PRIO_URGENT, data + 8, 8, 0) == 8,
+              "Urgent write failed");
+
+  /* Urgent data is read first, even though bulk data was written earlier */
+  TEST_ASSERT(cbuf_prio_read(&prio, out, 8, 0, &lane) == 8,
+              "Urgent read failed");
+  TEST_ASSERT(lane == CBUF_PRIO_URGENT && memcmp(out, data, 8) == 0,
+              "Expected the first urgent message");
+  TEST_ASSERT(cbuf_prio_read(&prio, out, sizeof(out), 0, &lane) == 8,
+              "Urgent read failed");
+  TEST_ASSERT(lane == CBUF_PRIO_URGENT && memcmp(out, data + 8, 8) == 0,
+              "Expected the second urgent message");
+
+  /* Only then the bulk lane, and never mixed with urgent data */
+  TEST_ASSERT(cbuf_prio_read(&prio, out, 100, 0, &lane) == 100,
+              "Bulk read failed");
+  TEST_ASSERT(lane == CBUF_PRIO_BULK && memcmp(out, data, 100) == 0,
+              "Expected bulk data");
+  TEST_ASSERT(cbuf_prio_write(&prio, CBUF_PRIO_URGENT, data, 4, 0) == 4,
+              "Urgent write failed");
+  TEST_ASSERT(cbuf_prio_read(&prio, out, sizeof(out), 0, NULL) == 4,
+              "Urgent data must preempt the remaining bulk data");
+
+  cbuf_prio_free(&prio);
+}
+
+void test_prio_threaded() {
+  cbuf_prio_t prio;
+  cbuf_prio_lane_t lane;
+  pthread_t producers[2];
+  prio_producer_arg_t args[2];
+  uint32_t next[2] = {0, 0}, v;
+  ssize_t n;
+
+  TEST_ASSERT(cbuf_prio_init(&prio, 512, 4096) == 0, "Init failed");
+
+  args[0] = (prio_producer_arg_t){&prio, CBUF_PRIO_BULK, NUM_BULK};
+  args[1] = (prio_producer_arg_t){&prio, CBUF_PRIO_URGENT, NUM_URGENT};
+  pthread_create(&producers[0], NULL, prio_producer, &args[0]);
+  pthread_create(&producers[1], NULL, prio_producer, &args[1]);
+
+  /* Each lane must stay in order */
+  while ((next[0] < NUM_BULK) || (next[1] < NUM_URGENT)) {
+    n = cbuf_prio_read(&prio, (uint8_t *)&v, sizeof(v), 5000, &lane);
+    TEST_ASSERT(n == sizeof(v), "Read failed");
+    TEST_ASSERT(v == next[lane], "Out of order data within a lane");
+    next[lane]++;
+  }
+
+  pthread_join(producers[0], NULL);
+  pthread_join(producers[1], NULL);
+
+  TEST_ASSERT(cbuf_prio_read(&prio, (uint8_t *)&v, sizeof(v), 0, &lane) == 0,
+              "Both lanes must be drained");
+
+  cbuf_prio_free(&prio);
+}
+
+int main() {
+  printf("Running priority ring tests...\n");
+
+  test_prio_basic();
+  printf("\x1B[92m  ✓ lane ordering tests passed\x1B[0m\n");
+
+  test_prio_threaded();
+  printf("\x1B[92m  ✓ threaded two-producer test passed\x1B[0m\n");
+
+  printf("All priority ring tests passed!\n");
+  return 0;
+}
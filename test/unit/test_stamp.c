@@ -0,0 +1,147 @@
+#include "cbuf_stamp.h"
+#include "test_utils.h"
+
+#define NUM_RECORDS 20000
+
+void *stamp_producer(void *arg) {
+  cbuf_t *cbuf = (cbuf_t *)arg;
+
+  for (uint32_t i = 0; i < NUM_RECORDS; i++)
+    TEST_ASSERT(cbuf_stamp_write(cbuf, (uint8_t *)&i, sizeof(i), -1) ==
+                    sizeof(i),
+                "Write failed");
+  return NULL;
+}
+
+void test_stamp_basic() {
+  cbuf_t cbuf;
+  cbuf_stamp_reader_t reader;
+  uint8_t data[100], out[100];
+
+  for (int i = 0; i < 100; i++)
+    data[i] = i;
+
+  TEST_ASSERT(cbuf_init(&cbuf, CBUF_MIN_CAPACITY) == 0, "Init failed");
+  TEST_ASSERT(cbuf_stamp_reader_init(&reader, 0) == 0, "Reader init failed");
+
+  TEST_ASSERT(cbuf_stamp_write(&cbuf, data, CBUF_MIN_CAPACITY, 0) == -1,
+              "Record larger than the cbuf must fail");
+  TEST_ASSERT(cbuf_stamp_read(&cbuf, &reader, out, sizeof(out), 0) == 0,
+              "Empty cbuf must time out");
+
+  /* Headers and payloads wrapping at every offset */
+  for (int i = 0; i < 200; i++) {
+    size_t len = 1 + (i % 100);
+    TEST_ASSERT(cbuf_stamp_write(&cbuf, data, len, 0) == (ssize_t)len,
+                "Write failed");
+    TEST_ASSERT(cbuf_get_readable_size(&cbuf) ==
+                    (ssize_t)(sizeof(cbuf_stamp_hdr_t) + len),
+                "Record must be published whole");
+    TEST_ASSERT(cbuf_stamp_read(&cbuf, &reader, out, 100, 0) == (ssize_t)len,
+                "Read failed");
+    TEST_ASSERT(memcmp(out, data, len) == 0, "Record data mismatch");
+  }
+  TEST_ASSERT(reader.records == 200 && reader.dropped_records == 0,
+              "Wrong record counters");
+
+  /* Too small a buffer leaves the record in place */
+  TEST_ASSERT(cbuf_stamp_write(&cbuf, data, 50, 0) == 50, "Write failed");
+  TEST_ASSERT(cbuf_stamp_read(&cbuf, &reader, out, 10, 0) == -1,
+              "Short buffer must fail");
+  TEST_ASSERT(cbuf_stamp_read(&cbuf, &reader, out, 100, 0) == 50,
+              "Record must still be readable");
+
+  cbuf_free(&cbuf);
+}
+
+void test_stamp_ttl() {
+  cbuf_t cbuf;
+  cbuf_stamp_reader_t reader;
+  uint32_t v;
+
+  TEST_ASSERT(cbuf_init(&cbuf, 4096) == 0, "Init failed");
+  TEST_ASSERT(cbuf_stamp_reader_init(&reader, 20 * 1000000ULL) == 0,
+              "Reader init failed");
+
+  /* 10 records go stale, then 3 fresh ones arrive */
+  for (v = 0; v < 10; v++)
+    cbuf_stamp_write(&cbuf, (uint8_t *)&v, sizeof(v), 0);
+  usleep(40000);
+  for (; v < 13; v++)
+    cbuf_stamp_write(&cbuf, (uint8_t *)&v, sizeof(v), 0);
+
+  TEST_ASSERT(cbuf_stamp_read(&cbuf, &reader, (uint8_t *)&v, sizeof(v), 0) ==
+                  sizeof(v),
+              "Read failed");
+  TEST_ASSERT(v == 10, "Stale records must be skipped");
+  TEST_ASSERT(reader.dropped_records == 10 &&
+                  reader.dropped_bytes == 10 * sizeof(v),
+              "Wrong drop counters");
+
+  /* Only stale records: consumed, then time out */
+  usleep(40000);
+  TEST_ASSERT(cbuf_stamp_read(&cbuf, &reader, (uint8_t *)&v, sizeof(v), 0) ==
+                  0,
+              "Nothing fresh must time out");
+  TEST_ASSERT(cbuf_is_empty(&cbuf) == 1, "Stale records must be consumed");
+  TEST_ASSERT(reader.dropped_records == 12, "Wrong drop counters");
+
+  cbuf_free(&cbuf);
+}
+
+void test_stamp_histogram() {
+  cbuf_t cbuf;
+  cbuf_stamp_reader_t reader;
+  pthread_t producer;
+  uint64_t p50, p99;
+  uint32_t v;
+
+  TEST_ASSERT(cbuf_init(&cbuf, 1024) == 0, "Init failed");
+  TEST_ASSERT(cbuf_stamp_reader_init(&reader, 0) == 0, "Reader init failed");
+  TEST_ASSERT(cbuf_stamp_percentile(&reader, 50) == 0, "No records yet");
+
+  pthread_create(&producer, NULL, stamp_producer, &cbuf);
+  for (uint32_t i = 0; i < NUM_RECORDS; i++) {
+    TEST_ASSERT(cbuf_stamp_read(&cbuf, &reader, (uint8_t *)&v, sizeof(v),
+                                5000) == sizeof(v),
+                "Read failed");
+    TEST_ASSERT(v == i, "Out of order record");
+  }
+  pthread_join(producer, NULL);
+
+  uint64_t total = 0;
+  for (unsigned int i = 0; i < CBUF_STAMP_BUCKETS; i++)
+    total += reader.hist[i];
+  TEST_ASSERT(total == NUM_RECORDS, "Every record must be in the histogram");
+
+  p50 = cbuf_stamp_percentile(&reader, 50);
+  p99 = cbuf_stamp_percentile(&reader, 99);
+  TEST_ASSERT(p50 > 0 && p50 <= p99, "Percentiles must be ordered");
+
+  /* The rank rounds up: p51 of two records is the second one */
+  TEST_ASSERT(cbuf_stamp_reader_init(&reader, 0) == 0, "Reader init failed");
+  reader.records = 2;
+  reader.hist[0] = 1;
+  reader.hist[10] = 1;
+  TEST_ASSERT(cbuf_stamp_percentile(&reader, 50) == 1, "Wrong p50");
+  TEST_ASSERT(cbuf_stamp_percentile(&reader, 51) == 2047, "Wrong p51");
+  TEST_ASSERT(cbuf_stamp_percentile(&reader, 0) == 1, "Wrong p0");
+
+  cbuf_free(&cbuf);
+}
+
+int main() {
+  printf("Running timestamped record tests...\n");
+
+  test_stamp_basic();
+  printf("\x1B[92m  ✓ basic record tests passed\x1B[0m\n");
+
+  test_stamp_ttl();
+  printf("\x1B[92m  ✓ TTL drop tests passed\x1B[0m\n");
+
+  test_stamp_histogram();
+  printf("\x1B[92m  ✓ residency histogram test passed\x1B[0m\n");
+
+  printf("All timestamped record tests passed!\n");
+  return 0;
+}
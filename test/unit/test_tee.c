@@ -0,0 +1,179 @@
+#include "cbuf_tee.h"
+#include "cbuf_timeout.h"
+#include "test_utils.h"
+
+#define NUM_MSGS 3000
+
+static char path[] = "/tmp/cbuf_test_tee_XXXXXX";
+
+void test_record_replay() {
+  cbuf_t cbuf, replay;
+  cbuf_tee_t tee;
+  cbuf_tee_stats_t stats;
+  uint8_t msg[64], out[64];
+  size_t total = 0;
+
+  TEST_ASSERT(cbuf_init(&cbuf, 1000) == 0, "Init failed");
+  TEST_ASSERT(cbuf_tee_start(&tee, &cbuf, path, 0) == 0, "Tee start failed");
+  TEST_ASSERT(cbuf_tee_start(&tee, &cbuf, path, 0) == -1,
+              "Double start must fail");
+
+  /* Messages of varying size through every kind of read, wrapping a lot */
+  for (uint32_t i = 0; i < NUM_MSGS; i++) {
+    size_t len = 1 + (i % sizeof(msg));
+    memset(msg, i & 0xFF, len);
+    TEST_ASSERT(cbuf_write_blocking(&cbuf, msg, len, 0) == (ssize_t)len,
+                "Write failed");
+    switch (i % 3) {
+    case 0:
+      TEST_ASSERT(cbuf_read_blocking(&cbuf, out, len, 0, true) == (ssize_t)len,
+                  "Read failed");
+      break;
+    case 1:
+      TEST_ASSERT(cbuf_remove(&cbuf, len) == (ssize_t)len, "Remove failed");
+      break;
+    default: {
+      cbuf_segs_t segs;
+      TEST_ASSERT(cbuf_get_read_segs(&cbuf, &segs) == (ssize_t)len,
+                  "Read segs failed");
+      TEST_ASSERT(cbuf_remove(&cbuf, len) == (ssize_t)len, "Remove failed");
+    }
+    }
+    total += len;
+  }
+
+  TEST_ASSERT(cbuf_tee_stop(&tee) == 0, "Tee stop failed");
+  TEST_ASSERT(cbuf_tee_get_stats(&tee, &stats) == 0, "Stats failed");
+  TEST_ASSERT(stats.bytes == total && stats.chunks == NUM_MSGS,
+              "Every read must be captured");
+  TEST_ASSERT(stats.dropped_bytes == 0, "Nothing must be dropped");
+  TEST_ASSERT(stats.blocks >= 1, "Nothing written");
+
+  /* Reads after stopping are not recorded */
+  TEST_ASSERT(cbuf_write_blocking(&cbuf, msg, 1, 0) == 1, "Write failed");
+  TEST_ASSERT(cbuf_remove(&cbuf, 1) == 1, "Remove failed");
+
+  /* Replay as fast as possible into a ring that holds it all */
+  TEST_ASSERT(cbuf_init(&replay, 1 << 20) == 0, "Init failed");
+  TEST_ASSERT(cbuf_replay(&replay, path, 0) == (ssize_t)total,
+              "Replay size mismatch");
+  for (uint32_t i = 0; i < NUM_MSGS; i++) {
+    size_t len = 1 + (i % sizeof(msg));
+    TEST_ASSERT(cbuf_read_blocking(&replay, out, len, 0, true) ==
+                    (ssize_t)len,
+                "Replay read failed");
+    for (size_t j = 0; j < len; j++)
+      TEST_ASSERT(out[j] == (i & 0xFF), "Replay data mismatch");
+  }
+  TEST_ASSERT(cbuf_is_empty(&replay) == 1, "Replay must hold nothing else");
+
+  cbuf_free(&replay);
+  cbuf_free(&cbuf);
+}
+
+void test_large_reads_and_drops() {
+  cbuf_t cbuf, replay;
+  cbuf_tee_t tee;
+  cbuf_tee_stats_t stats;
+  uint8_t *data = malloc(200000), *out = malloc(200000);
+
+  for (size_t i = 0; i < 200000; i++)
+    data[i] = (i * 7) & 0xFF;
+
+  /* Reads larger than a block are split across blocks */
+  TEST_ASSERT(cbuf_init(&cbuf, 1 << 18) == 0, "Init failed");
+  TEST_ASSERT(cbuf_tee_start(&tee, &cbuf, path, 1 << 20) == 0,
+              "Tee start failed");
+  TEST_ASSERT(cbuf_write_blocking(&cbuf, data, 200000, 0) == 200000,
+              "Write failed");
+  TEST_ASSERT(cbuf_read_blocking(&cbuf, out, 200000, 0, true) == 200000,
+              "Read failed");
+  TEST_ASSERT(cbuf_tee_stop(&tee) == 0, "Tee stop failed");
+  TEST_ASSERT(cbuf_tee_get_stats(&tee, &stats) == 0, "Stats failed");
+  TEST_ASSERT(stats.blocks >= 200000 / CBUF_TEE_BLOCK_SIZE + 1,
+              "Large read must span blocks");
+
+  TEST_ASSERT(cbuf_init(&replay, 1 << 18) == 0, "Init failed");
+  TEST_ASSERT(cbuf_replay(&replay, path, 0) == 200000, "Replay failed");
+  memset(out, 0, 200000);
+  TEST_ASSERT(cbuf_read_blocking(&replay, out, 200000, 0, true) == 200000,
+              "Replay read failed");
+  TEST_ASSERT(memcmp(out, data, 200000) == 0, "Replay data mismatch");
+  cbuf_free(&replay);
+
+  /* A staging cbuf too small for the burst drops it without blocking */
+  TEST_ASSERT(cbuf_tee_start(&tee, &cbuf, path, CBUF_MIN_CAPACITY) == 0,
+              "Tee start failed");
+  TEST_ASSERT(cbuf_write_blocking(&cbuf, data, 1000, 0) == 1000,
+              "Write failed");
+  TEST_ASSERT(cbuf_read_blocking(&cbuf, out, 1000, 0, true) == 1000,
+              "Read failed");
+  TEST_ASSERT(cbuf_tee_stop(&tee) == 0, "Tee stop failed");
+  TEST_ASSERT(cbuf_tee_get_stats(&tee, &stats) == 0, "Stats failed");
+  TEST_ASSERT(stats.dropped_bytes == 1000 && stats.bytes == 0,
+              "Burst must be dropped");
+
+  cbuf_free(&cbuf);
+  free(data);
+  free(out);
+}
+
+void test_replay_timing() {
+  cbuf_t cbuf, replay;
+  cbuf_tee_t tee;
+  uint8_t byte = 1;
+  int64_t begin, elapsed;
+
+  TEST_ASSERT(cbuf_init(&cbuf, CBUF_MIN_CAPACITY) == 0, "Init failed");
+  TEST_ASSERT(cbuf_tee_start(&tee, &cbuf, path, 0) == 0, "Tee start failed");
+  for (int i = 0; i < 3; i++) {
+    if (i)
+      usleep(30000);
+    cbuf_write_blocking(&cbuf, &byte, 1, 0);
+    cbuf_remove(&cbuf, 1);
+  }
+  TEST_ASSERT(cbuf_tee_stop(&tee) == 0, "Tee stop failed");
+
+  /* Recorded 60ms apart end to end */
+  TEST_ASSERT(cbuf_init(&replay, CBUF_MIN_CAPACITY) == 0, "Init failed");
+  begin = cbuf_time_now_usec();
+  TEST_ASSERT(cbuf_replay(&replay, path, 1.0) == 3, "Replay failed");
+  elapsed = cbuf_time_now_usec() - begin;
+  TEST_ASSERT(elapsed >= 55000, "Replay must keep the original timing");
+
+  begin = cbuf_time_now_usec();
+  TEST_ASSERT(cbuf_remove(&replay, 3) == 3, "Remove failed");
+  TEST_ASSERT(cbuf_replay(&replay, path, 4.0) == 3, "Replay failed");
+  elapsed = cbuf_time_now_usec() - begin;
+  TEST_ASSERT((elapsed >= 13000) && (elapsed < 55000),
+              "Replay must scale the timing");
+
+  TEST_ASSERT(cbuf_replay(&replay, "/nonexistent/cbuf_tee", 0) == -1,
+              "Missing file must fail");
+
+  cbuf_free(&replay);
+  cbuf_free(&cbuf);
+}
+
+int main() {
+  int fd;
+
+  printf("Running tee recorder tests...\n");
+
+  fd = mkstemp(path);
+  TEST_ASSERT(fd >= 0, "mkstemp failed");
+  close(fd);
+
+  test_record_replay();
+  printf("\x1B[92m  ✓ record/replay tests passed\x1B[0m\n");
+
+  test_large_reads_and_drops();
+  printf("\x1B[92m  ✓ large read/drop tests passed\x1B[0m\n");
+
+  test_replay_timing();
+  printf("\x1B[92m  ✓ replay timing test passed\x1B[0m\n");
+
+  unlink(path);
+  printf("All tee recorder tests passed!\n");
+  return 0;
+}
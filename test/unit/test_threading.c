@@ -109,6 +109,55 @@ void test_parallel_operations() {
   cbuf_free(&cbuf);
 }
 
+typedef struct {
+  cbuf_t *dst, *src;
+  size_t total;
+} splice_arg_t;
+
+void *forwarder_thread(void *arg) {
+  splice_arg_t *fwd = (splice_arg_t *)arg;
+  size_t moved = 0;
+
+  while (moved < fwd->total) {
+    ssize_t n = cbuf_splice(fwd->dst, fwd->src, fwd->total - moved, -1);
+    TEST_ASSERT(n > 0, "Splice failed");
+    moved += n;
+  }
+  return NULL;
+}
+
+void test_splice_forwarding() {
+  cbuf_t in, out;
+  test_context_t in_ctx, out_ctx;
+  splice_arg_t fwd = {&out, &in, 0};
+  pthread_t producer, forwarder, consumer;
+
+  /* Differently sized rings, so the wrap points keep moving apart */
+  TEST_ASSERT(cbuf_init(&in, 1000) == 0, "Failed to initialize buffer");
+  TEST_ASSERT(cbuf_init(&out, 777) == 0, "Failed to initialize buffer");
+
+  /* 2000 items, 50 bytes each, infinite timeout */
+  test_context_init(&in_ctx, &in, 2000, 50, -1);
+  test_context_init(&out_ctx, &out, 2000, 50, -1);
+  fwd.total = in_ctx.num_items * in_ctx.item_size;
+
+  pthread_create(&producer, NULL, producer_thread, &in_ctx);
+  pthread_create(&forwarder, NULL, forwarder_thread, &fwd);
+  pthread_create(&consumer, NULL, consumer_thread, &out_ctx);
+
+  pthread_join(producer, NULL);
+  pthread_join(forwarder, NULL);
+  pthread_join(consumer, NULL);
+
+  TEST_ASSERT(counter_get(&out_ctx.consumed) == out_ctx.num_items,
+              "Consumer didn't receive all forwarded items");
+
+  test_context_destroy(&in_ctx);
+  test_context_destroy(&out_ctx);
+  cbuf_free(&in);
+  cbuf_free(&out);
+}
+
 int main() {
   printf("Running threading tests...\n");
 
@@ -118,6 +167,9 @@ int main() {
   test_parallel_operations();
   printf("\x1B[92m  ✓ Parallel operations test passed\x1B[0m\n");
 
+  test_splice_forwarding();
+  printf("\x1B[92m  ✓ Splice forwarding test passed\x1B[0m\n");
+
   printf("All threading tests passed!\n");
   return 0;
 }
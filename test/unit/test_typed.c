@@ -0,0 +1,161 @@
+#include "cbuf_typed.h"
+#include "test_utils.h"
+
+typedef struct {
+  uint64_t seq;
+  uint32_t kind;
+  uint32_t len;
+  uint8_t payload[16];
+} msg_t;
+
+CBUF_DEFINE_TYPED(msgq, msg_t, 16);
+CBUF_DEFINE_TYPED(u32q, uint32_t, 1024);
+
+static msg_t make_msg(uint64_t seq) {
+  msg_t m;
+  m.seq = seq;
+  m.kind = (uint32_t)(seq % 7);
+  m.len = (uint32_t)sizeof(m.payload);
+  for (size_t j = 0; j < sizeof(m.payload); j++)
+    m.payload[j] = (seq + j) & 0xFF;
+  return m;
+}
+
+static bool check_msg(const msg_t *m, uint64_t seq) {
+  msg_t want = make_msg(seq);
+  return !memcmp(m, &want, sizeof(want));
+}
+
+void test_push_pop() {
+  static msgq_t q;
+  msg_t m;
+
+  TEST_ASSERT(msgq_init(&q) == 0, "Initialization failed");
+  TEST_ASSERT(msgq_get_capacity() == 16, "Incorrect capacity");
+  TEST_ASSERT(msgq_is_empty(&q) > 0, "New ring must be empty");
+  TEST_ASSERT(msgq_pop(&q, &m, 0) == 0, "Pop from empty ring must time out");
+
+  /* All N slots are usable */
+  for (uint64_t i = 0; i < 16; i++)
+    TEST_ASSERT(msgq_push(&q, make_msg(i), 0) == 1, "Push failed");
+  TEST_ASSERT(msgq_is_full(&q) > 0, "Ring must be full");
+  TEST_ASSERT(msgq_push(&q, make_msg(16), 0) == 0,
+              "Push to full ring must time out");
+
+  for (uint64_t i = 0; i < 16; i++) {
+    TEST_ASSERT(msgq_pop(&q, &m, 0) == 1, "Pop failed");
+    TEST_ASSERT(check_msg(&m, i), "Popped element mismatch");
+  }
+  TEST_ASSERT(msgq_is_empty(&q) > 0, "Ring must be empty after popping");
+}
+
+void test_bulk_wrap() {
+  static msgq_t q;
+  msg_t in[16], out[16];
+  uint64_t seq_in = 0, seq_out = 0;
+
+  TEST_ASSERT(msgq_init(&q) == 0, "Initialization failed");
+  TEST_ASSERT(msgq_push_bulk(&q, in, 17, 0) == -1,
+              "Bulk push larger than N must fail");
+
+  /* Odd-sized batches so that copies straddle the wrap point */
+  for (int round = 0; round < 50; round++) {
+    size_t n = 1 + (round * 5) % 11;
+
+    for (size_t i = 0; i < n; i++)
+      in[i] = make_msg(seq_in++);
+    TEST_ASSERT(msgq_push_bulk(&q, in, n, 0) == (ssize_t)n,
+                "Bulk push failed");
+
+    TEST_ASSERT(msgq_pop_bulk(&q, out, n, 0, true) == (ssize_t)n,
+                "Bulk pop failed");
+    for (size_t i = 0; i < n; i++)
+      TEST_ASSERT(check_msg(&out[i], seq_out++), "Bulk element mismatch");
+  }
+
+  /* All-or-nothing semantics */
+  TEST_ASSERT(msgq_push_bulk(&q, in, 3, 0) == 3, "Bulk push failed");
+  TEST_ASSERT(msgq_pop_bulk(&q, out, 4, 0, true) == 0,
+              "All-or-nothing pop must not read a partial batch");
+  TEST_ASSERT(msgq_pop_bulk(&q, out, 4, 0, false) == 3,
+              "Partial pop must read what is available");
+  TEST_ASSERT(msgq_push_bulk(&q, in, 16, 0) == 16, "Bulk push failed");
+  TEST_ASSERT(msgq_push_bulk(&q, in, 1, 0) == 0,
+              "Bulk push to full ring must time out");
+}
+
+static u32q_t shared_q;
+#define NUM_ITEMS 200000
+
+void *typed_producer(void *arg) {
+  uint32_t batch[32];
+  uint32_t next = 0;
+
+  (void)arg;
+  while (next < NUM_ITEMS) {
+    if (next % 3) {
+      TEST_ASSERT(u32q_push(&shared_q, next, -1) == 1, "Push failed");
+      next++;
+    } else {
+      size_t n = MIN((size_t)32, (size_t)(NUM_ITEMS - next));
+      for (size_t i = 0; i < n; i++)
+        batch[i] = next + i;
+      TEST_ASSERT(u32q_push_bulk(&shared_q, batch, n, -1) == (ssize_t)n,
+                  "Bulk push failed");
+      next += n;
+    }
+  }
+  return NULL;
+}
+
+void *typed_consumer(void *arg) {
+  uint32_t batch[64], val;
+  uint32_t expect = 0;
+  ssize_t n;
+
+  (void)arg;
+  while (expect < NUM_ITEMS) {
+    if (expect % 2) {
+      TEST_ASSERT(u32q_pop(&shared_q, &val, -1) == 1, "Pop failed");
+      TEST_ASSERT(val == expect, "Out of order element");
+      expect++;
+    } else {
+      n = u32q_pop_bulk(&shared_q, batch, 64, 1000, false);
+      TEST_ASSERT(n > 0, "Bulk pop timed out");
+      for (ssize_t i = 0; i < n; i++)
+        TEST_ASSERT(batch[i] == expect++, "Out of order element");
+    }
+  }
+  return NULL;
+}
+
+void test_typed_producer_consumer() {
+  pthread_t producer, consumer;
+
+  TEST_ASSERT(u32q_init(&shared_q) == 0, "Initialization failed");
+
+  pthread_create(&producer, NULL, typed_producer, NULL);
+  pthread_create(&consumer, NULL, typed_consumer, NULL);
+
+  pthread_join(producer, NULL);
+  pthread_join(consumer, NULL);
+
+  TEST_ASSERT(u32q_is_empty(&shared_q) > 0,
+              "Ring must be empty after equal production and consumption");
+}
+
+int main() {
+  printf("Running typed ring tests...\n");
+
+  test_push_pop();
+  printf("\x1B[92m  ✓ push/pop tests passed\x1B[0m\n");
+
+  test_bulk_wrap();
+  printf("\x1B[92m  ✓ bulk push/pop tests passed\x1B[0m\n");
+
+  test_typed_producer_consumer();
+  printf("\x1B[92m  ✓ typed producer-consumer test passed\x1B[0m\n");
+
+  printf("All typed ring tests passed!\n");
+  return 0;
+}
@@ -0,0 +1,166 @@
+#include "test_utils.h"
+
+#define NUM_MSGS 50000
+#define MSG_SIZE 32
+#define LOW_MARK 256
+#define HIGH_MARK 3072
+
+typedef struct {
+  _Atomic(bool) paused;
+  _Atomic(int) highs;
+  _Atomic(int) lows;
+  _Atomic(bool) misordered;
+} flow_t;
+
+static void on_watermark(cbuf_t *cbuf, bool high, void *arg) {
+  flow_t *flow = (flow_t *)arg;
+
+  (void)cbuf;
+  /* Edges must alternate, starting with a high one */
+  if (atomic_exchange(&flow->paused, high) == high)
+    atomic_store(&flow->misordered, true);
+  if (high)
+    atomic_fetch_add(&flow->highs, 1);
+  else
+    atomic_fetch_add(&flow->lows, 1);
+}
+
+void *flow_producer(void *arg) {
+  cbuf_t *cbuf = (cbuf_t *)arg;
+  flow_t *flow = (flow_t *)cbuf->wm.arg;
+  uint8_t msg[MSG_SIZE];
+
+  for (uint32_t i = 0; i < NUM_MSGS; i++) {
+    /* Upstream is paused above the high watermark */
+    while (atomic_load(&flow->paused))
+      usleep(10);
+
+    memset(msg, i & 0xFF, sizeof(msg));
+    TEST_ASSERT(cbuf_waitfor_writable(cbuf, sizeof(msg), -1) == 1,
+                "Wait for writable failed");
+    TEST_ASSERT(cbuf_write_blocking(cbuf, msg, sizeof(msg), 0) == sizeof(msg),
+                "Space promised by cbuf_waitfor_writable() must be there");
+  }
+  return NULL;
+}
+
+void test_waitfor_writable() {
+  cbuf_t cbuf;
+  uint8_t buf[CBUF_MIN_CAPACITY];
+
+  memset(buf, 0, sizeof(buf));
+  TEST_ASSERT(cbuf_init(&cbuf, CBUF_MIN_CAPACITY) == 0, "Init failed");
+
+  TEST_ASSERT(cbuf_waitfor_writable(NULL, 1, 0) == -1, "NULL must fail");
+  TEST_ASSERT(cbuf_waitfor_writable(&cbuf, 0, 0) == -1, "Zero bytes must fail");
+  TEST_ASSERT(cbuf_waitfor_writable(&cbuf, CBUF_MIN_CAPACITY, 0) == -1,
+              "More than the capacity must fail");
+  TEST_ASSERT(cbuf_waitfor_writable(&cbuf, CBUF_MIN_CAPACITY - 1, 0) == 1,
+              "Empty ring must be writable");
+
+  TEST_ASSERT(cbuf_write_blocking(&cbuf, buf, 500, 0) == 500, "Write failed");
+  TEST_ASSERT(cbuf_waitfor_writable(&cbuf, 11, 0) == 1, "Must be writable");
+  TEST_ASSERT(cbuf_waitfor_writable(&cbuf, 12, 20) == 0, "Must time out");
+
+  /* Pending batched bytes are published while waiting */
+  TEST_ASSERT(cbuf_remove(&cbuf, 500) == 500, "Remove failed");
+  TEST_ASSERT(cbuf_set_batching(&cbuf, SIZE_MAX, 0) == 0, "Batching failed");
+  TEST_ASSERT(cbuf_write_blocking(&cbuf, buf, 500, 0) == 500, "Write failed");
+  TEST_ASSERT(cbuf_waitfor_writable(&cbuf, 12, 0) == 0, "Must time out");
+  TEST_ASSERT(cbuf_get_readable_size(&cbuf) == 500,
+              "Waiting writer must publish pending bytes");
+
+  cbuf_free(&cbuf);
+}
+
+void test_watermarks_basic() {
+  cbuf_t cbuf;
+  flow_t flow = {0};
+  uint8_t buf[1024];
+
+  memset(buf, 0, sizeof(buf));
+  TEST_ASSERT(cbuf_init(&cbuf, 1024) == 0, "Init failed");
+
+  TEST_ASSERT(cbuf_set_watermarks(&cbuf, 512, 512, on_watermark, &flow) == -1,
+              "Low must be below high");
+  TEST_ASSERT(cbuf_set_watermarks(&cbuf, 0, 1024, on_watermark, &flow) == -1,
+              "High above the capacity must fail");
+  TEST_ASSERT(cbuf_set_watermarks(&cbuf, 100, 800, on_watermark, &flow) == 0,
+              "Set watermarks failed");
+
+  TEST_ASSERT(cbuf_write_blocking(&cbuf, buf, 799, 0) == 799, "Write failed");
+  TEST_ASSERT(flow.highs == 0, "Below the high watermark");
+  TEST_ASSERT(cbuf_write_blocking(&cbuf, buf, 1, 0) == 1, "Write failed");
+  TEST_ASSERT(flow.highs == 1 && flow.paused, "High watermark missed");
+  TEST_ASSERT(cbuf_write_blocking(&cbuf, buf, 100, 0) == 100, "Write failed");
+  TEST_ASSERT(flow.highs == 1, "High edge must only fire once");
+
+  TEST_ASSERT(cbuf_read_blocking(&cbuf, buf, 800, 0, true) == 800,
+              "Read failed");
+  TEST_ASSERT(flow.lows == 1 && !flow.paused, "Low watermark missed");
+
+  /* Zero-copy paths hook in too */
+  cbuf_segs_t segs;
+  TEST_ASSERT(cbuf_get_write_segs(&cbuf, &segs) >= 800, "No space");
+  TEST_ASSERT(cbuf_commit(&cbuf, 800) == 800, "Commit failed");
+  TEST_ASSERT(flow.highs == 2, "Commit must cross the high watermark");
+  TEST_ASSERT(cbuf_remove(&cbuf, 1000) == 900, "Remove failed");
+  TEST_ASSERT(flow.lows == 2, "Remove must cross the low watermark");
+
+  /* Already above the high watermark when set */
+  TEST_ASSERT(cbuf_set_watermarks(&cbuf, 0, 0, NULL, NULL) == 0,
+              "Disable failed");
+  TEST_ASSERT(cbuf_write_blocking(&cbuf, buf, 900, 0) == 900, "Write failed");
+  TEST_ASSERT(flow.highs == 2, "Disabled watermarks must not fire");
+  TEST_ASSERT(cbuf_set_watermarks(&cbuf, 100, 800, on_watermark, &flow) == 0,
+              "Set watermarks failed");
+  TEST_ASSERT(flow.highs == 3, "Initial level must be checked");
+  TEST_ASSERT(!flow.misordered, "Edges must alternate");
+
+  cbuf_free(&cbuf);
+}
+
+void test_watermarks_threaded() {
+  cbuf_t cbuf;
+  flow_t flow = {0};
+  pthread_t producer;
+  uint8_t msg[MSG_SIZE];
+
+  TEST_ASSERT(cbuf_init(&cbuf, 4096) == 0, "Init failed");
+  TEST_ASSERT(cbuf_set_watermarks(&cbuf, LOW_MARK, HIGH_MARK, on_watermark,
+                                  &flow) == 0,
+              "Set watermarks failed");
+  pthread_create(&producer, NULL, flow_producer, &cbuf);
+
+  for (uint32_t i = 0; i < NUM_MSGS; i++) {
+    TEST_ASSERT(cbuf_read_blocking(&cbuf, msg, sizeof(msg), 5000, true) ==
+                    sizeof(msg),
+                "Read timed out; lost low watermark edge?");
+    TEST_ASSERT(msg[0] == (i & 0xFF), "Out of order message");
+    /* Slow consumer, so the producer runs into the high watermark */
+    if (i % 128 == 0)
+      usleep(200);
+  }
+
+  pthread_join(producer, NULL);
+  TEST_ASSERT(!flow.misordered, "Edges must alternate");
+  TEST_ASSERT(flow.highs > 0, "Producer must have been paused");
+  TEST_ASSERT(flow.highs == flow.lows, "Every pause must be resumed");
+  cbuf_free(&cbuf);
+}
+
+int main() {
+  printf("Running flow control tests...\n");
+
+  test_waitfor_writable();
+  printf("\x1B[92m  ✓ waitfor_writable tests passed\x1B[0m\n");
+
+  test_watermarks_basic();
+  printf("\x1B[92m  ✓ basic watermark tests passed\x1B[0m\n");
+
+  test_watermarks_threaded();
+  printf("\x1B[92m  ✓ threaded watermark test passed\x1B[0m\n");
+
+  printf("All flow control tests passed!\n");
+  return 0;
+}
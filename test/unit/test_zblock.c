@@ -0,0 +1,272 @@
+#include "cbuf_zblock.h"
+#include "test_utils.h"
+
+#define BLOCK_SIZE (16U << 10)
+#define TEXT_SIZE (1U << 20)
+
+static const char *paths[] = {"/api/v1/items", "/api/v1/users",
+                              "/api/v1/orders", "/healthz"};
+
+/* Log-like, highly compressible text */
+static void make_text(uint8_t *buf, size_t n, uint32_t seed) {
+  char line[128];
+  size_t i = 0, len;
+
+  while (i < n) {
+    seed = seed * 1103515245U + 12345U;
+    len = (size_t)snprintf(
+        line, sizeof(line),
+        "2024-05-01T12:00:%02u INFO %s %s/%u status=%u latency_ms=%u\n",
+        (seed >> 8) % 60, (seed & 0x100) ? "GET" : "POST",
+        paths[(seed >> 16) % 4], (seed >> 20) % 1000,
+        (seed & 0x1000) ? 200 : 404, (seed >> 24) % 100);
+    len = MIN(len, n - i);
+    memcpy(buf + i, line, len);
+    i += len;
+  }
+}
+
+static void make_random(uint8_t *buf, size_t n, uint32_t seed) {
+  for (size_t i = 0; i < n; i++) {
+    seed = seed * 1103515245U + 12345U;
+    buf[i] = (uint8_t)(seed >> 16);
+  }
+}
+
+typedef struct {
+  cbuf_t *cbuf;
+  const uint8_t *data;
+  size_t len;
+} zproducer_arg_t;
+
+void *zproducer(void *arg) {
+  zproducer_arg_t *p = (zproducer_arg_t *)arg;
+  cbuf_zwriter_t w;
+  size_t off = 0, n;
+  uint32_t seed = 1;
+
+  TEST_ASSERT(cbuf_zwriter_init(&w, p->cbuf, BLOCK_SIZE) == 0, "Init failed");
+  while (off < p->len) {
+    seed = seed * 1103515245U + 12345U;
+    n = MIN(1 + (seed >> 16) % 3000, p->len - off);
+    TEST_ASSERT(cbuf_zwrite(&w, p->data + off, n, -1) == (ssize_t)n,
+                "Write failed");
+    off += n;
+  }
+  TEST_ASSERT(cbuf_zflush(&w, -1) == 1, "Flush failed");
+  TEST_ASSERT(cbuf_zstats_ratio(&w.stats) > 3.0,
+              "Text must compress at least 3x");
+  cbuf_zwriter_free(&w);
+  return NULL;
+}
+
+void test_lz_roundtrip() {
+  static uint8_t src[CBUF_Z_MAX_BLOCK], z[CBUF_Z_BOUND(CBUF_Z_MAX_BLOCK)],
+      out[CBUF_Z_MAX_BLOCK];
+  static uint32_t table[1U << CBUF_Z_HASH_LOG];
+  size_t sizes[] = {0, 1, 3, 4, 5, 17, 255, 1000, 4096, CBUF_Z_MAX_BLOCK};
+  size_t zlen;
+
+  for (int kind = 0; kind < 3; kind++) {
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+      size_t n = sizes[i];
+
+      if (kind == 0)
+        make_text(src, n, (uint32_t)i);
+      else if (kind == 1)
+        make_random(src, n, (uint32_t)i);
+      else
+        memset(src, 'a', n);
+
+      zlen = cbuf_lz_compress(src, n, z, sizeof(z), table);
+      TEST_ASSERT(zlen > 0 && zlen <= CBUF_Z_BOUND(n), "Compress failed");
+      TEST_ASSERT(cbuf_lz_decompress(z, zlen, out, n) == (ssize_t)n,
+                  "Decompress failed");
+      TEST_ASSERT(memcmp(src, out, n) == 0, "Round trip mismatch");
+      if ((kind != 1) && (n >= 4096))
+        TEST_ASSERT(zlen < n / 3, "Redundant data must compress well");
+    }
+  }
+
+  /* Giving up early when the output would not shrink */
+  make_random(src, 4096, 7);
+  TEST_ASSERT(cbuf_lz_compress(src, 4096, z, 4095, table) == 0,
+              "Random data must not fit in less space");
+}
+
+void test_lz_corrupt() {
+  static uint8_t src[4096], z[CBUF_Z_BOUND(4096)], bad[CBUF_Z_BOUND(4096)],
+      out[4096];
+  static uint32_t table[1U << CBUF_Z_HASH_LOG];
+  size_t zlen;
+  uint32_t seed = 99;
+
+  make_text(src, sizeof(src), 3);
+  zlen = cbuf_lz_compress(src, sizeof(src), z, sizeof(z), table);
+
+  TEST_ASSERT(cbuf_lz_decompress(z, zlen, out, sizeof(src) - 1) == -1,
+              "Too small an output buffer must be rejected");
+  TEST_ASSERT(cbuf_lz_decompress(z, zlen - 1, out, sizeof(out)) != 4096,
+              "Truncated input must not decode fully");
+
+  /* Random corruption must never crash or overrun */
+  for (int i = 0; i < 10000; i++) {
+    memcpy(bad, z, zlen);
+    for (int j = 0; j < 4; j++) {
+      seed = seed * 1103515245U + 12345U;
+      bad[(seed >> 8) % zlen] ^= (uint8_t)(seed >> 24) | 1;
+    }
+    ssize_t n = cbuf_lz_decompress(bad, zlen, out, sizeof(out));
+    TEST_ASSERT(n <= (ssize_t)sizeof(out), "Decoder overran its output");
+  }
+
+  /* Offset pointing before the start of the output */
+  uint8_t evil[] = {0x10, 'x', 0x05, 0x00};
+  TEST_ASSERT(cbuf_lz_decompress(evil, sizeof(evil), out, sizeof(out)) == -1,
+              "Out of range offset must be rejected");
+}
+
+void test_zblock_basic() {
+  cbuf_t cbuf;
+  cbuf_zwriter_t w;
+  cbuf_zreader_t r;
+  static uint8_t data[3 * BLOCK_SIZE + 100], out[sizeof(data)];
+  size_t off = 0;
+  ssize_t n;
+
+  make_text(data, sizeof(data), 1);
+
+  TEST_ASSERT(cbuf_init(&cbuf, 4096) == 0, "Init failed");
+  TEST_ASSERT(cbuf_zwriter_init(&w, &cbuf, BLOCK_SIZE) == -1,
+              "Block size larger than the cbuf must fail");
+  cbuf_free(&cbuf);
+
+  TEST_ASSERT(cbuf_init(&cbuf, 64U << 10) == 0, "Init failed");
+  TEST_ASSERT(cbuf_zwriter_init(&w, &cbuf, CBUF_Z_MAX_BLOCK + 1) == -1,
+              "Block size over the max must fail");
+  TEST_ASSERT(cbuf_zwriter_init(&w, &cbuf, BLOCK_SIZE) == 0, "Init failed");
+  TEST_ASSERT(cbuf_zreader_init(&r, &cbuf, BLOCK_SIZE) == 0, "Init failed");
+
+  TEST_ASSERT(cbuf_zread(&r, out, sizeof(out), 0) == 0,
+              "Empty cbuf must time out");
+
+  /* Nothing is visible until a block is published */
+  TEST_ASSERT(cbuf_zwrite(&w, data, 100, 0) == 100, "Write failed");
+  TEST_ASSERT(cbuf_is_empty(&cbuf) == 1, "Partial block must not publish");
+  TEST_ASSERT(cbuf_zwrite(&w, data + 100, sizeof(data) - 100, 0) ==
+                  sizeof(data) - 100,
+              "Write failed");
+  TEST_ASSERT(w.stats.blocks == 3, "Three full blocks must be published");
+  TEST_ASSERT(cbuf_zflush(&w, 0) == 1, "Flush failed");
+  TEST_ASSERT(cbuf_zflush(&w, 0) == 1, "Empty flush must succeed");
+  TEST_ASSERT(w.stats.blocks == 4 && w.stats.raw_bytes == sizeof(data),
+              "Wrong writer stats");
+  TEST_ASSERT(cbuf_get_readable_size(&cbuf) == (ssize_t)w.stats.z_bytes,
+              "Only compressed bytes must be in the cbuf");
+  TEST_ASSERT(cbuf_zstats_ratio(&w.stats) > 3.0, "Text must compress");
+
+  /* Reads never span blocks */
+  n = cbuf_zread(&r, out, sizeof(out), 0);
+  TEST_ASSERT(n == BLOCK_SIZE, "Read must stop at the block boundary");
+  off = n;
+  while (off < sizeof(data)) {
+    n = cbuf_zread(&r, out + off, 1000, 0);
+    TEST_ASSERT(n > 0, "Read failed");
+    off += n;
+  }
+  TEST_ASSERT(memcmp(data, out, sizeof(data)) == 0, "Data mismatch");
+  TEST_ASSERT(r.stats.blocks == 4 && r.stats.z_bytes == w.stats.z_bytes,
+              "Wrong reader stats");
+  TEST_ASSERT(cbuf_is_empty(&cbuf) == 1, "All blocks must be consumed");
+
+  /* Incompressible data is stored as is */
+  make_random(data, BLOCK_SIZE, 5);
+  TEST_ASSERT(cbuf_zwrite(&w, data, BLOCK_SIZE, 0) == BLOCK_SIZE,
+              "Write failed");
+  TEST_ASSERT(cbuf_get_readable_size(&cbuf) ==
+                  (ssize_t)(sizeof(cbuf_zblock_hdr_t) + BLOCK_SIZE),
+              "Random block must be stored uncompressed");
+  TEST_ASSERT(cbuf_zread(&r, out, sizeof(out), 0) == BLOCK_SIZE,
+              "Read failed");
+  TEST_ASSERT(memcmp(data, out, BLOCK_SIZE) == 0, "Data mismatch");
+
+  /* A full cbuf accepts data up to the pending block, then times out */
+  make_random(data, sizeof(data), 6);
+  TEST_ASSERT(cbuf_zwrite(&w, data, sizeof(data), 0) == sizeof(data),
+              "Write failed");
+  n = cbuf_zwrite(&w, data, sizeof(data), 0);
+  TEST_ASSERT(n > 0 && n < (ssize_t)sizeof(data), "Expected a short write");
+  TEST_ASSERT(cbuf_zwrite(&w, data + n, sizeof(data) - n, 0) == 0,
+              "Full cbuf must time out");
+  TEST_ASSERT(cbuf_zread(&r, out, sizeof(out), 0) == BLOCK_SIZE,
+              "Read failed");
+  TEST_ASSERT(cbuf_zflush(&w, 0) == 1, "Pending block must be published");
+
+  /* A corrupt header is rejected and left in place */
+  cbuf_zreader_free(&r);
+  cbuf_zwriter_free(&w);
+  cbuf_free(&cbuf);
+
+  TEST_ASSERT(cbuf_init(&cbuf, 4096) == 0, "Init failed");
+  TEST_ASSERT(cbuf_zreader_init(&r, &cbuf, 1024) == 0, "Init failed");
+  cbuf_zblock_hdr_t hdr = {100, 2048};
+  cbuf_write_blocking(&cbuf, (uint8_t *)&hdr, sizeof(hdr), 0);
+  TEST_ASSERT(cbuf_zread(&r, out, sizeof(out), 0) == -1,
+              "Oversized block must be rejected");
+  TEST_ASSERT(cbuf_get_readable_size(&cbuf) == sizeof(hdr),
+              "Rejected block must stay in the cbuf");
+  cbuf_zreader_free(&r);
+  cbuf_free(&cbuf);
+}
+
+void test_zblock_threaded() {
+  cbuf_t cbuf;
+  cbuf_zreader_t r;
+  pthread_t producer;
+  zproducer_arg_t arg;
+  uint8_t *data = malloc(TEXT_SIZE), *out = malloc(TEXT_SIZE);
+  size_t off = 0;
+  ssize_t n;
+
+  TEST_ASSERT(data && out, "Allocation failed");
+  make_text(data, TEXT_SIZE, 11);
+
+  /* Smaller than the data, so the producer has to wait on the reader */
+  TEST_ASSERT(cbuf_init(&cbuf, 3 * BLOCK_SIZE) == 0, "Init failed");
+  TEST_ASSERT(cbuf_zreader_init(&r, &cbuf, BLOCK_SIZE) == 0, "Init failed");
+
+  arg = (zproducer_arg_t){&cbuf, data, TEXT_SIZE};
+  pthread_create(&producer, NULL, zproducer, &arg);
+  while (off < TEXT_SIZE) {
+    n = cbuf_zread(&r, out + off, 777, 5000);
+    TEST_ASSERT(n > 0, "Read failed");
+    off += n;
+  }
+  pthread_join(producer, NULL);
+
+  TEST_ASSERT(memcmp(data, out, TEXT_SIZE) == 0, "Data mismatch");
+
+  cbuf_zreader_free(&r);
+  cbuf_free(&cbuf);
+  free(data);
+  free(out);
+}
+
+int main() {
+  printf("Running compressed block tests...\n");
+
+  test_lz_roundtrip();
+  printf("\x1B[92m  ✓ codec round trip tests passed\x1B[0m\n");
+
+  test_lz_corrupt();
+  printf("\x1B[92m  ✓ corrupt input tests passed\x1B[0m\n");
+
+  test_zblock_basic();
+  printf("\x1B[92m  ✓ block writer/reader tests passed\x1B[0m\n");
+
+  test_zblock_threaded();
+  printf("\x1B[92m  ✓ threaded stream test passed\x1B[0m\n");
+
+  printf("All compressed block tests passed!\n");
+  return 0;
+}